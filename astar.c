@@ -0,0 +1,307 @@
+//astar.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "astar.h"
+#include "distfield.h"
+#include "chunkmap.h"
+#include "spacetime.h"
+
+#define SLOT_CLOSED -1
+
+typedef struct {
+    int f;
+    int g;
+    int cell;
+} HeapEntry;
+
+// per-cell state, valid only where stamp[cell] == generation
+static unsigned int* stamp = NULL;
+static int* g_cost = NULL;
+static int* heap_slot = NULL;      // position in heap, or SLOT_CLOSED
+static uint8_t* parent = NULL;     // move that reached the cell
+static HeapEntry* heap = NULL;
+static int* trail = NULL;          // goal-to-start cells while rebuilding the path
+static int capacity = 0;
+static unsigned int generation = 0;
+
+long astar_expanded = 0;
+
+static void ensure_capacity(void) {
+    if (capacity >= grid_cells) return;
+    astar_release();
+
+    stamp = calloc(grid_cells, sizeof(unsigned int));
+    g_cost = malloc(sizeof(int) * grid_cells);
+    heap_slot = malloc(sizeof(int) * grid_cells);
+    parent = malloc(grid_cells);
+    heap = malloc(sizeof(HeapEntry) * grid_cells);
+    trail = malloc(sizeof(int) * grid_cells);
+    if (!stamp || !g_cost || !heap_slot || !parent || !heap || !trail) {
+        perror("malloc");
+        exit(1);
+    }
+    capacity = grid_cells;
+    generation = 0;
+}
+
+// paged search state (astar_search_paged)
+typedef struct {
+    int f, g;
+    int x, y, z;
+} PagedEntry;
+
+static SpaceTimeTable paged_state;   // cell -> a: g + 1, b: parent move | PAGED_CLOSED
+static PagedEntry* paged_heap = NULL;
+static int paged_heap_capacity = 0;
+static Move* paged_trail = NULL;
+static int paged_trail_capacity = 0;
+
+#define PAGED_CLOSED 8
+
+void astar_release(void) {
+    st_free(&paged_state);
+    free(paged_heap);
+    free(paged_trail);
+    paged_heap = NULL;
+    paged_trail = NULL;
+    paged_heap_capacity = paged_trail_capacity = 0;
+
+    free(stamp);
+    free(g_cost);
+    free(heap_slot);
+    free(parent);
+    free(heap);
+    free(trail);
+    stamp = NULL;
+    g_cost = heap_slot = trail = NULL;
+    parent = NULL;
+    heap = NULL;
+    capacity = 0;
+}
+
+// Manhattan distance between padded cell indices
+static inline int manhattan(int cell, int gx, int gy, int gz) {
+    int z = cell / stride_z;
+    int rest = cell - z * stride_z;
+    int y = rest / stride_y;
+    int x = rest - y * stride_y;
+    return abs(x - gx) + abs(y - gy) + abs(z - gz);
+}
+
+// lower f first; on ties the deeper node, which is closer to the goal
+static inline int heap_before(const HeapEntry* a, const HeapEntry* b) {
+    return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+static void sift_up(int i) {
+    HeapEntry e = heap[i];
+    while (i > 0) {
+        int up = (i - 1) / 2;
+        if (!heap_before(&e, &heap[up])) break;
+        heap[i] = heap[up];
+        heap_slot[heap[i].cell] = i;
+        i = up;
+    }
+    heap[i] = e;
+    heap_slot[e.cell] = i;
+}
+
+static void sift_down(int i, int n) {
+    HeapEntry e = heap[i];
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap_before(&heap[child + 1], &heap[child])) child++;
+        if (!heap_before(&heap[child], &e)) break;
+        heap[i] = heap[child];
+        heap_slot[heap[i].cell] = i;
+        i = child;
+    }
+    heap[i] = e;
+    heap_slot[e.cell] = i;
+}
+
+int astar_search(int start, int goal, Move* path, int max_moves, const int32_t* h_field) {
+    ensure_capacity();
+
+    if (++generation == 0) {   // wrapped: old stamps could look current
+        memset(stamp, 0, sizeof(unsigned int) * capacity);
+        generation = 1;
+    }
+
+    int gz = goal / stride_z;
+    int gy = (goal - gz * stride_z) / stride_y;
+    int gx = goal - gz * stride_z - gy * stride_y;
+
+    // a field cut off from the goal gives no guidance: fall back to Manhattan
+    if (h_field && h_field[start] == DIST_UNREACHABLE) h_field = NULL;
+#define HEURISTIC(cell) (h_field ? h_field[cell] : manhattan(cell, gx, gy, gz))
+
+    heap[0] = (HeapEntry){ HEURISTIC(start), 0, start };
+    heap_slot[start] = 0;
+    g_cost[start] = 0;
+    stamp[start] = generation;
+    int n = 1;
+
+    int reached = start;
+    int reached_h = heap[0].f;
+    long expanded = 0;
+
+    while (n > 0) {
+        HeapEntry cur = heap[0];
+        if (--n > 0) {
+            heap[0] = heap[n];
+            sift_down(0, n);
+        }
+        heap_slot[cur.cell] = SLOT_CLOSED;
+        expanded++;
+
+        int h = cur.f - cur.g;
+        if (h < reached_h) {
+            reached_h = h;
+            reached = cur.cell;
+        }
+        if (cur.cell == goal) break;
+
+        for (int m = 0; m < 6; m++) {
+            int next = cur.cell + move_delta[m];
+            if (map_cell(next) == 1) continue;   // border cells are obstacles
+            if (h_field && h_field[next] == DIST_UNREACHABLE) continue;
+
+            int g = cur.g + 1;
+            if (stamp[next] != generation) {
+                stamp[next] = generation;
+                g_cost[next] = g;
+                parent[next] = (uint8_t)m;
+                heap[n] = (HeapEntry){ g + HEURISTIC(next), g, next };
+                sift_up(n++);
+            } else if (heap_slot[next] != SLOT_CLOSED && g < g_cost[next]) {
+                int slot = heap_slot[next];
+                heap[slot].f -= g_cost[next] - g;
+                heap[slot].g = g;
+                g_cost[next] = g;
+                parent[next] = (uint8_t)m;
+                sift_up(slot);
+            }
+        }
+    }
+#undef HEURISTIC
+    astar_expanded += expanded;
+
+    // walk back to the start, then emit the moves start-first
+    int steps = 0;
+    for (int cell = reached; cell != start; cell -= move_delta[parent[cell]])
+        trail[steps++] = cell;
+
+    int count = steps < max_moves ? steps : max_moves;
+    for (int i = 0; i < count; i++)
+        path[i] = (Move)parent[trail[steps - 1 - i]];
+    return count;
+}
+
+// ---------- paged maps ----------
+
+static inline int paged_before(const PagedEntry* a, const PagedEntry* b) {
+    return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+static void paged_push(int* n, PagedEntry e) {
+    if (*n == paged_heap_capacity) {
+        paged_heap_capacity = paged_heap_capacity ? 2 * paged_heap_capacity : 1024;
+        paged_heap = realloc(paged_heap, sizeof(PagedEntry) * paged_heap_capacity);
+        if (!paged_heap) { perror("realloc"); exit(1); }
+    }
+    int i = (*n)++;
+    while (i > 0) {
+        int up = (i - 1) / 2;
+        if (!paged_before(&e, &paged_heap[up])) break;
+        paged_heap[i] = paged_heap[up];
+        i = up;
+    }
+    paged_heap[i] = e;
+}
+
+static PagedEntry paged_pop(int* n) {
+    PagedEntry top = paged_heap[0];
+    PagedEntry e = paged_heap[--(*n)];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= *n) break;
+        if (child + 1 < *n && paged_before(&paged_heap[child + 1], &paged_heap[child])) child++;
+        if (!paged_before(&paged_heap[child], &e)) break;
+        paged_heap[i] = paged_heap[child];
+        i = child;
+    }
+    if (*n > 0) paged_heap[i] = e;
+    return top;
+}
+
+int astar_search_paged(Point start, Point goal, Move* path, int max_moves) {
+    if (!paged_state.entries) st_init(&paged_state, 4096);
+    else st_clear(&paged_state);
+
+#define PAGED_H(px, py, pz) (abs((px) - goal.x) + abs((py) - goal.y) + abs((pz) - goal.z))
+    int n = 0;
+    paged_push(&n, (PagedEntry){ PAGED_H(start.x, start.y, start.z), 0, start.x, start.y, start.z });
+    st_insert(&paged_state, chunkmap_index(start.x, start.y, start.z))->a = 1;
+
+    PagedEntry reached = paged_heap[0];
+    int reached_h = reached.f;
+    long expanded = 0;
+
+    // no decrease-key here: a cell may be queued more than once, and only the
+    // copy with its current g is expanded
+    while (n > 0) {
+        PagedEntry cur = paged_pop(&n);
+        SpaceTimeEntry* s = st_find(&paged_state, chunkmap_index(cur.x, cur.y, cur.z));
+        if ((s->b & PAGED_CLOSED) || cur.g + 1 != s->a) continue;
+        s->b |= PAGED_CLOSED;
+        expanded++;
+
+        int h = cur.f - cur.g;
+        if (h < reached_h) {
+            reached_h = h;
+            reached = cur;
+        }
+        if (h == 0) break;
+
+        for (int m = 0; m < 6; m++) {
+            int x = cur.x + chunk_move_step[m][0];
+            int y = cur.y + chunk_move_step[m][1];
+            int z = cur.z + chunk_move_step[m][2];
+            if (chunkmap_cell(x, y, z) == 1) continue;   // off the map too
+
+            int g = cur.g + 1;
+            SpaceTimeEntry* e = st_insert(&paged_state, chunkmap_index(x, y, z));
+            if (e->a && ((e->b & PAGED_CLOSED) || g + 1 >= e->a)) continue;
+            e->a = g + 1;
+            e->b = m;
+            paged_push(&n, (PagedEntry){ g + PAGED_H(x, y, z), g, x, y, z });
+        }
+    }
+#undef PAGED_H
+    astar_expanded += expanded;
+
+    // walk back to the start, then emit the moves start-first
+    int steps = 0;
+    int x = reached.x, y = reached.y, z = reached.z;
+    while (x != start.x || y != start.y || z != start.z) {
+        if (steps == paged_trail_capacity) {
+            paged_trail_capacity = paged_trail_capacity ? 2 * paged_trail_capacity : 1024;
+            paged_trail = realloc(paged_trail, sizeof(Move) * paged_trail_capacity);
+            if (!paged_trail) { perror("realloc"); exit(1); }
+        }
+        Move m = (Move)(st_find(&paged_state, chunkmap_index(x, y, z))->b & 7);
+        paged_trail[steps++] = m;
+        x -= chunk_move_step[m][0];
+        y -= chunk_move_step[m][1];
+        z -= chunk_move_step[m][2];
+    }
+
+    int count = steps < max_moves ? steps : max_moves;
+    for (int i = 0; i < count; i++)
+        path[i] = paged_trail[steps - 1 - i];
+    return count;
+}
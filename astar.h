@@ -0,0 +1,29 @@
+//astar.h
+// A* over the padded grid (6 moves, unit cost). The open set is a binary heap
+// with a cell -> heap slot index for decrease-key; per-cell search state is
+// kept between calls and invalidated by bumping a generation stamp, so a
+// search costs what it expands, not the size of the map.
+#ifndef ASTAR_H
+#define ASTAR_H
+
+#include "genetic.h"
+
+// Writes the moves from start to goal (both padded cell indices) into path
+// and returns how many. If goal is unreachable the path ends at the reached
+// cell closest to it (by the heuristic); 0 when start == goal. At most
+// max_moves moves are written.
+// h_field, if not NULL, is the heuristic: distances to goal per cell, e.g.
+// distfield_from(goal), which is exact, so only the path itself is expanded.
+// NULL uses the Manhattan distance.
+int astar_search(int start, int goal, Move* path, int max_moves, const int32_t* h_field);
+
+// The same search over the paged store (chunkmap.h), by coordinates and with
+// the Manhattan heuristic; search state is hashed, so it costs what it
+// expands whatever the map size.
+int astar_search_paged(Point start, Point goal, Move* path, int max_moves);
+
+void astar_release(void);   // frees the search state (kept across calls)
+
+extern long astar_expanded;   // cells taken off the heap, over all searches
+
+#endif
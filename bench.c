@@ -0,0 +1,1532 @@
+// bench.c
+// performance benchmarks, run with: ./rescue --bench [map]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "graph.h"
+#include "genetic.h"
+#include "multi.h"
+#include "queue.h"
+#include "fitcache.h"
+#include "fitness.h"
+#include "netmig.h"
+#include "rng.h"
+#include "astar.h"
+#include "distfield.h"
+#include "team.h"
+#include "cbs.h"
+#include "chunkmap.h"
+#include "rlemap.h"
+#include "explore.h"
+
+#define BENCH_GENERATIONS 20
+#define BENCH_PINGPONGS   200000
+#define BENCH_KERNEL_PATHS 512
+#define BENCH_KERNEL_REPS  20
+#define BENCH_FRAMES      100000
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Writes a random map in the text format load_3d_map() reads:
+// ~15% obstacles, ~3% risk cells and a few survivors.
+static void write_random_map(const char* path, int sx, int sy, int sz, unsigned seed) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) { perror("bench map"); exit(1); }
+
+    srand(seed);
+    for (int z = 0; z < sz; z++) {
+        if (z > 0) fprintf(fp, "\n");
+        for (int y = 0; y < sy; y++) {
+            for (int x = 0; x < sx; x++) {
+                int r = rand() % 1000;
+                int cell = 0;
+                if (r < 150) cell = 1;
+                else if (r < 180) cell = 3;
+                else if (r < 185) cell = 2;
+                fprintf(fp, x ? " %d" : "%d", cell);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+    fclose(fp);
+}
+
+// ---------- generation wall time vs. number of robot workers, per backend ----------
+static void bench_generation_scaling(void) {
+    int saved_generations = MAX_GENERATIONS;
+    int saved_backend = EVAL_BACKEND;
+    int counts[] = {1, 2, 4, 8};
+    int backends[] = {BACKEND_PROCESSES, BACKEND_THREADS};
+    const char* names[] = {"processes", "threads"};
+
+    MAX_GENERATIONS = BENCH_GENERATIONS;
+    printf("\n[bench] generation wall time vs worker count "
+           "(population %d, %d generations)\n", POPULATION_SIZE, MAX_GENERATIONS);
+    printf("  backend   | workers | ms/generation | evaluations/sec\n");
+
+    double base = 0;
+    for (int b = 0; b < 2; b++) {
+        EVAL_BACKEND = backends[b];
+        for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+            rng_seed(&ga_rng, 1, 0);
+            fitness_cache_clear();   // every run must pay for its own evaluations
+            genes_simulated = genes_resumed = 0;
+            init_robot_pool(counts[k]);
+
+            double t0 = now_ms();
+            Chromosome* final = genetic_algorithm();
+            double elapsed = now_ms() - t0;
+
+            // same seed, so every row must end on the same population
+            double best = final[0].fitness;
+            for (int i = 1; i < POPULATION_SIZE; i++)
+                if (final[i].fitness > best) best = final[i].fitness;
+            free_population(final);
+
+            shutdown_robot_pool();
+
+            int elite_count = (int)(POPULATION_SIZE * ELITE_PERCENT);
+            if (elite_count < 1) elite_count = 1;
+            long evals = POPULATION_SIZE + (long)MAX_GENERATIONS * (POPULATION_SIZE - elite_count);
+
+            double per_gen = elapsed / MAX_GENERATIONS;
+            if (base == 0) base = per_gen;
+            printf("  %-9s | %7d | %13.3f | %15.0f  (x%.2f)  best %.2f, heap allocs in loop: %ld, genes resumed: %.1f%%\n",
+                   names[b], counts[k], per_gen, evals / (elapsed / 1000.0), base / per_gen,
+                   best, ga_loop_allocations,
+                   100.0 * genes_resumed / (genes_simulated + genes_resumed + 1e-9));
+        }
+    }
+
+    EVAL_BACKEND = saved_backend;
+    MAX_GENERATIONS = saved_generations;
+}
+
+// ---------- processes backend: the pool follows the backlog ----------
+static void bench_elastic_pool(void) {
+    int saved_backend = EVAL_BACKEND;
+    int limit = available_cpus() > TEAM_SIZE ? available_cpus() : TEAM_SIZE;
+    int sizes[] = {1, 8, 32, 128, 512};
+    int most = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+
+    EVAL_BACKEND = BACKEND_PROCESSES;
+    printf("\n[bench] elastic robot pool (%d CPUs available, limit %d robots)\n",
+           available_cpus(), limit);
+    printf("  batch | robots after | ms/batch\n");
+
+    rng_seed(&ga_rng, 1, 0);
+    Chromosome* paths = alloc_population(most);
+    Chromosome** batch = malloc(sizeof(Chromosome*) * most);
+    if (!batch) { perror("malloc"); exit(1); }
+    for (int i = 0; i < most; i++) {
+        create_valid_individual(&paths[i]);
+        batch[i] = &paths[i];
+    }
+
+    init_robot_pool(limit);
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        double t0 = now_ms();
+        robot_evaluate_batch(batch, sizes[k]);
+        printf("  %5d | %12d | %8.3f\n", sizes[k], child_count, now_ms() - t0);
+    }
+
+    // make every other robot idle: exactly those must leave, whichever
+    // robots wake up first
+    pid_t* stays = calloc(limit, sizeof(pid_t));   // pid that must stay, 0 = leaves
+    if (!stays) { perror("calloc"); exit(1); }
+    int aged = 0, before = child_count, wrong = 0;
+    for (int i = 0, live = 0; i < limit; i++) {
+        if (child_pool[i].robot_id < 0) continue;
+        if (live++ % 2) { child_pool[i].last_used -= 3600; aged++; }
+        else stays[i] = child_pool[i].pid;
+    }
+    aging(60);
+    for (int i = 0; i < limit; i++)
+        wrong += child_pool[i].robot_id >= 0 ? child_pool[i].pid != stays[i] : stays[i] != 0;
+    free(stays);
+    printf("  aging(60) with %d of %d robots idle: %d robots left, %s\n",
+           aged, before, child_count, wrong ? "WRONG ROBOTS RETIRED" : "the idle ones retired");
+
+    // every robot just finished a job, so a zero idle limit retires them all
+    double t0 = now_ms();
+    aging(0);
+    printf("  aging(0): %d robots left, %ld retired in %.3f ms\n",
+           child_count, robots_retired, now_ms() - t0);
+
+    t0 = now_ms();
+    robot_evaluate_batch(batch, sizes[1]);
+    printf("  regrow for %d jobs: %d robots, %.3f ms\n", sizes[1], child_count, now_ms() - t0);
+
+    shutdown_robot_pool();
+    free(batch);
+    free_population(paths);
+    EVAL_BACKEND = saved_backend;
+}
+
+// ---------- initial seeding: generations until the best path is good enough ----------
+#define BENCH_SEEDING_RUNS 16
+
+static void bench_seeding_convergence(void) {
+    int saved_generations = MAX_GENERATIONS;
+    int saved_backend = EVAL_BACKEND;
+    double saved_gradient = SEEDING_GRADIENT, saved_astar = SEEDING_ASTAR;
+    struct { const char* name; double gradient, astar; } mixes[] = {
+        { "random walks", 0.0, 0.0 },
+        { "gradient", 1.0, 0.0 },
+        { "A*", 0.0, 1.0 },
+        { "config mix", saved_gradient, saved_astar },
+    };
+    int count = sizeof(mixes) / sizeof(mixes[0]);
+
+    MAX_GENERATIONS = 200;
+    EVAL_BACKEND = BACKEND_THREADS;
+    double* history = malloc(sizeof(double) * count * BENCH_SEEDING_RUNS * (MAX_GENERATIONS + 1));
+    if (!history) { perror("malloc"); exit(1); }
+
+    init_robot_pool(0);
+    for (int m = 0; m < count; m++) {
+        SEEDING_GRADIENT = mixes[m].gradient;
+        SEEDING_ASTAR = mixes[m].astar;
+        for (int r = 0; r < BENCH_SEEDING_RUNS; r++) {
+            ga_best_history = history + (size_t)(m * BENCH_SEEDING_RUNS + r) * (MAX_GENERATIONS + 1);
+            rng_seed(&ga_rng, 100 + r, 0);
+            fitness_cache_clear();
+            free_population(genetic_algorithm());
+        }
+    }
+    ga_best_history = NULL;
+    shutdown_robot_pool();
+
+    // target: what random-walk seeding (mixes[0]) ends on, on average
+    double target = 0;
+    for (int r = 0; r < BENCH_SEEDING_RUNS; r++)
+        target += history[(size_t)r * (MAX_GENERATIONS + 1) + MAX_GENERATIONS] / BENCH_SEEDING_RUNS;
+
+    printf("\n[bench] initial seeding: generations until best fitness >= %.2f "
+           "(random walks' mean final best; %d runs each, %d generations, population %d)\n",
+           target, BENCH_SEEDING_RUNS, MAX_GENERATIONS, POPULATION_SIZE);
+    printf("  seeding       | gradient  A*   | initial best | final best | runs at target | mean generations\n");
+
+    for (int m = 0; m < count; m++) {
+        double initial = 0, final = 0, generations = 0;
+        int reached = 0;
+        for (int r = 0; r < BENCH_SEEDING_RUNS; r++) {
+            double* h = history + (size_t)(m * BENCH_SEEDING_RUNS + r) * (MAX_GENERATIONS + 1);
+            initial += h[0];
+            final += h[MAX_GENERATIONS];
+            for (int g = 0; g <= MAX_GENERATIONS; g++) {
+                if (h[g] >= target) {
+                    generations += g;
+                    reached++;
+                    break;
+                }
+            }
+        }
+        printf("  %-13s | %8.2f %5.2f | %12.2f | %10.2f | %8d/%d    | ",
+               mixes[m].name, mixes[m].gradient, mixes[m].astar,
+               initial / BENCH_SEEDING_RUNS, final / BENCH_SEEDING_RUNS, reached, BENCH_SEEDING_RUNS);
+        if (reached) printf("%.1f\n", generations / reached);
+        else printf("-\n");
+    }
+
+    free(history);
+    SEEDING_GRADIENT = saved_gradient;
+    SEEDING_ASTAR = saved_astar;
+    EVAL_BACKEND = saved_backend;
+    MAX_GENERATIONS = saved_generations;
+}
+
+// ---------- island mode: each worker evolves its own subpopulation ----------
+static void bench_island_scaling(void) {
+    int saved_generations = MAX_GENERATIONS;
+    int saved_mode = ISLAND_MODE;
+    int counts[] = {1, 2, 4, 8};
+
+    MAX_GENERATIONS = BENCH_GENERATIONS;
+    ISLAND_MODE = 1;
+    printf("\n[bench] island model: generation wall time vs island count "
+           "(population %d per island, %d generations, migrate every %d)\n",
+           POPULATION_SIZE, MAX_GENERATIONS, MIGRATION_INTERVAL);
+    printf("  islands | ms/generation | evaluations/sec\n");
+
+    double base = 0;
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        rng_seed(&ga_rng, 1, 0);
+        fitness_cache_clear();
+        genes_simulated = genes_resumed = 0;
+
+        // islands start evolving as soon as they are forked
+        double t0 = now_ms();
+        init_robot_pool(counts[k]);
+        free_population(genetic_algorithm());
+        double elapsed = now_ms() - t0;
+
+        shutdown_robot_pool();
+
+        int elite_count = (int)(POPULATION_SIZE * ELITE_PERCENT);
+        if (elite_count < 1) elite_count = 1;
+        long evals = (long)counts[k] *
+                     (POPULATION_SIZE + (long)MAX_GENERATIONS * (POPULATION_SIZE - elite_count));
+
+        double rate = evals / (elapsed / 1000.0);
+        if (k == 0) base = rate;
+        printf("  %7d | %13.3f | %15.0f  (x%.2f)  heap allocs in loop: %ld\n",
+               counts[k], elapsed / MAX_GENERATIONS, rate, rate / base, ga_loop_allocations);
+    }
+
+    ISLAND_MODE = saved_mode;
+    MAX_GENERATIONS = saved_generations;
+}
+
+// ---------- job round-trip latency: SysV semaphores vs shared rings ----------
+static double pingpong_semaphores(int rounds) {
+    int sid = semget(IPC_PRIVATE, 2, IPC_CREAT | 0660);
+    struct sembuf ping_post = {0, 1, 0}, ping_wait = {0, -1, 0};
+    struct sembuf pong_post = {1, 1, 0}, pong_wait = {1, -1, 0};
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < rounds; i++) {
+            semop(sid, &ping_wait, 1);
+            semop(sid, &pong_post, 1);
+        }
+        _exit(0);
+    }
+
+    double t0 = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        semop(sid, &ping_post, 1);
+        semop(sid, &pong_wait, 1);
+    }
+    double elapsed = now_ms() - t0;
+
+    waitpid(pid, NULL, 0);
+    semctl(sid, 0, IPC_RMID);
+    return elapsed * 1000.0 / rounds;
+}
+
+static double pingpong_queues(int rounds) {
+    size_t bytes = (queue_bytes(QUEUE_MIN_CAPACITY) + 63) & ~(size_t)63;
+    char* mem = mmap(NULL, 2 * bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) { perror("mmap"); exit(1); }
+    JobQueue* q[2] = { (JobQueue*)mem, (JobQueue*)(mem + bytes) };
+    queue_init(q[0], QUEUE_MIN_CAPACITY);
+    queue_init(q[1], QUEUE_MIN_CAPACITY);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < rounds; i++)
+            queue_push(q[1], queue_pop_wait(q[0]));
+        _exit(0);
+    }
+
+    double t0 = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        queue_push(q[0], i);
+        queue_pop_wait(q[1]);
+    }
+    double elapsed = now_ms() - t0;
+
+    waitpid(pid, NULL, 0);
+    munmap(mem, 2 * bytes);
+    return elapsed * 1000.0 / rounds;
+}
+
+static void bench_ipc_latency(void) {
+    printf("\n[bench] job round-trip latency (%d ping-pongs)\n", BENCH_PINGPONGS);
+    double sem_us = pingpong_semaphores(BENCH_PINGPONGS);
+    double ring_us = pingpong_queues(BENCH_PINGPONGS);
+    printf("  SysV semaphores : %8.3f us\n", sem_us);
+    printf("  shared rings    : %8.3f us  (x%.2f)\n", ring_us, sem_us / ring_us);
+}
+
+// ---------- selection phase cost vs population size ----------
+// the pre-ranking scheme: a full exchange sort for every child bred
+static void legacy_exchange_sort(Chromosome* population, int n) {
+    for (int i = 0; i < n - 1; i++)
+        for (int j = i + 1; j < n; j++)
+            if (population[j].fitness > population[i].fitness) {
+                Chromosome temp = population[i];
+                population[i] = population[j];
+                population[j] = temp;
+            }
+}
+
+static void bench_selection_scaling(void) {
+    int saved_population = POPULATION_SIZE;
+    int sizes[] = {50, 500, 5000, 50000};
+    static uint64_t genes[6] = {MOVE_POS_X, MOVE_NEG_X, MOVE_POS_Y, MOVE_NEG_Y, MOVE_POS_Z, MOVE_NEG_Z};
+
+    printf("\n[bench] selection phase per generation vs population size\n");
+    printf("  population | ranked (ms) | ns/child | per-child sort (ms)\n");
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        int n = sizes[k];
+        POPULATION_SIZE = n;
+
+        Chromosome* population = malloc(sizeof(Chromosome) * n);
+        int* ranking = malloc(sizeof(int) * n);
+        srand(7);
+        for (int i = 0; i < n; i++) {
+            population[i].genes = &genes[i % 6];
+            population[i].length = 1;
+            population[i].start = (Point){0, 0, 0};
+            population[i].fitness = rand() % 1000 - 500;
+        }
+
+        double t0 = now_ms();
+        rank_population(population, ranking, tournament_size());
+        for (int i = 0; i < n; i++) {
+            int p1, p2;
+            select_parents(population, ranking, &p1, &p2);
+        }
+        double ranked = now_ms() - t0;
+
+        printf("  %10d | %11.3f | %8.1f | ", n, ranked, ranked * 1e6 / n);
+
+        if (n <= 500) {
+            t0 = now_ms();
+            for (int i = 0; i < n; i++) {
+                legacy_exchange_sort(population, n);
+                (void)population[rand() % tournament_size()];
+            }
+            printf("%19.3f\n", now_ms() - t0);
+        } else {
+            printf("%19s\n", "(too slow)");
+        }
+
+        free(population);
+        free(ranking);
+    }
+
+    POPULATION_SIZE = saved_population;
+}
+
+// ---------- collision detection cost vs team size ----------
+// the pairwise scheme: every time step replays each path from its start and
+// compares all pairs of positions, then counts robots per cell over the map
+static CollisionReport legacy_detect_collisions(const Chromosome* team, int n) {
+    CollisionReport report = {0, 0, 0, 0};
+
+    int max_length = 0;
+    for (int i = 0; i < n; i++)
+        if (team[i].length > max_length) max_length = team[i].length;
+
+    int* positions = malloc(sizeof(int) * n);
+    int* robots = calloc(grid_cells, sizeof(int));
+    int* last = calloc(grid_cells, sizeof(int));
+    if (!positions || !robots || !last) { perror("malloc"); exit(1); }
+
+    for (int t = 0; t < max_length; t++) {
+        for (int r = 0; r < n; r++) {
+            positions[r] = -1;
+            if (t >= team[r].length) continue;
+            int idx = point_to_index(team[r].start);
+            int m;
+            for (m = 0; m < t; m++) {
+                int next = idx + move_delta[get_move(&team[r], m)];
+                if (map_cell(next) == 1) break;
+                idx = next;
+            }
+            if (m == t) positions[r] = idx;
+        }
+        for (int i = 0; i < n; i++)
+            for (int j = i + 1; j < n; j++)
+                if (positions[i] >= 0 && positions[i] == positions[j])
+                    report.total_temporal_collisions++;
+    }
+
+    for (int r = 0; r < n; r++) {
+        int idx = point_to_index(team[r].start);
+        for (int i = 0; ; i++) {
+            if (last[idx] != r + 1) {
+                last[idx] = r + 1;
+                robots[idx]++;
+            }
+            if (i == team[r].length) break;
+            idx += move_delta[get_move(&team[r], i)];
+            if (map_cell(idx) == 1) break;
+        }
+    }
+    for (int idx = 0; idx < grid_cells; idx++) {
+        if (robots[idx] > 1) {
+            report.total_spatial_collisions += robots[idx] - 1;
+            report.conflicted_cells_count++;
+        }
+    }
+
+    free(positions);
+    free(robots);
+    free(last);
+    return report;
+}
+
+static void bench_collision_scaling(void) {
+    int teams[] = {8, 64, 512};
+    int largest = teams[sizeof(teams) / sizeof(teams[0]) - 1];
+
+    int saved_population = POPULATION_SIZE;
+    POPULATION_SIZE = largest;
+    Chromosome* team = alloc_population(largest);
+    rng_seed(&ga_rng, 17, 0);
+    for (int i = 0; i < largest; i++) create_valid_individual(&team[i]);
+    POPULATION_SIZE = saved_population;
+
+    printf("\n[bench] collision detection vs team size (random walks)\n");
+    printf("  robots | space-time (ms) | temporal | spatial | swaps | pairwise (ms)\n");
+
+    for (size_t k = 0; k < sizeof(teams) / sizeof(teams[0]); k++) {
+        int n = teams[k];
+
+        double t0 = now_ms();
+        CollisionReport fast = detect_collisions(team, n);
+        double fast_ms = now_ms() - t0;
+
+        printf("  %6d | %15.3f | %8d | %7d | %5d | ", n, fast_ms,
+               fast.total_temporal_collisions, fast.total_spatial_collisions,
+               fast.total_swap_conflicts);
+
+        if (n <= 64) {
+            t0 = now_ms();
+            CollisionReport slow = legacy_detect_collisions(team, n);
+            double slow_ms = now_ms() - t0;
+            int same = slow.total_temporal_collisions == fast.total_temporal_collisions &&
+                       slow.total_spatial_collisions == fast.total_spatial_collisions &&
+                       slow.conflicted_cells_count == fast.conflicted_cells_count;
+            printf("%13.3f (x%.0f%s)\n", slow_ms, slow_ms / fast_ms, same ? "" : ", MISMATCH");
+        } else {
+            printf("%13s\n", "(too slow)");
+        }
+    }
+
+    free_population(team);
+}
+
+// ---------- team co-evolution: independent bests vs TEAM_MODE ----------
+#define BENCH_TEAM_RUNS 4
+
+static void bench_team_coevolution(void) {
+    int saved_generations = MAX_GENERATIONS;
+    int saved_backend = EVAL_BACKEND;
+    int saved_team_mode = TEAM_MODE;
+
+    // the reservation table must charge exactly what detect_collisions()
+    // counts when the paths join the team one at a time
+    Chromosome* walks = alloc_population(TEAM_SIZE);
+    rng_seed(&ga_rng, 19, 0);
+    for (int i = 0; i < TEAM_SIZE; i++) create_valid_individual(&walks[i]);
+    ReservationTable reserved;
+    reservation_init(&reserved, 64);
+    double charged = 0;
+    for (int i = 0; i < TEAM_SIZE; i++) {
+        charged += collision_penalty(reservation_conflicts(&reserved, &walks[i]));
+        reservation_add(&reserved, &walks[i]);
+    }
+    double counted = collision_penalty(detect_collisions(walks, TEAM_SIZE));
+    reservation_free(&reserved);
+    free_population(walks);
+
+    MAX_GENERATIONS = 100;
+    EVAL_BACKEND = BACKEND_THREADS;
+
+    double fitness[2] = {0, 0}, collisions[2] = {0, 0}, ms[2] = {0, 0};
+    int clean[2] = {0, 0};
+
+    for (int mode = 0; mode <= 1; mode++) {
+        TEAM_MODE = mode;
+
+        for (int r = 0; r < BENCH_TEAM_RUNS; r++) {
+            init_robot_pool(0);
+            rng_seed(&ga_rng, 200 + r, 0);
+            fitness_cache_clear();
+
+            double t0 = now_ms();
+            free_population(genetic_algorithm());
+            ms[mode] += now_ms() - t0;
+
+            Chromosome team[TEAM_SIZE];
+            for (int i = 0; i < TEAM_SIZE; i++) team[i] = get_best_for_robot(i);
+            CollisionReport c = detect_collisions(team, TEAM_SIZE);
+            int n = c.total_temporal_collisions + c.total_spatial_collisions + c.total_swap_conflicts;
+            fitness[mode] += evaluate_team_fitness(team, TEAM_SIZE);
+            collisions[mode] += n;
+            if (n == 0) clean[mode]++;
+            shutdown_robot_pool();
+        }
+    }
+
+    printf("\n[bench] team co-evolution, %d runs x %d generations (population %d per run / per member)\n",
+           BENCH_TEAM_RUNS, MAX_GENERATIONS, POPULATION_SIZE);
+    printf("  incremental penalty of %d random walks: %.0f (detect_collisions: %.0f)\n",
+           TEAM_SIZE, charged, counted);
+    printf("  mode        | team fitness | collisions | collision-free runs | ms/run\n");
+    for (int mode = 0; mode <= 1; mode++)
+        printf("  %-11s | %12.2f | %10.1f | %17d/%d | %6.1f\n", mode ? "TEAM_MODE=1" : "independent",
+               fitness[mode] / BENCH_TEAM_RUNS, collisions[mode] / BENCH_TEAM_RUNS,
+               clean[mode], BENCH_TEAM_RUNS, ms[mode] / BENCH_TEAM_RUNS);
+
+    TEAM_MODE = saved_team_mode;
+    EVAL_BACKEND = saved_backend;
+    MAX_GENERATIONS = saved_generations;
+}
+
+// ---------- CBS repair of independently evolved teams ----------
+#define BENCH_REPAIR_RUNS 8
+
+static void bench_cbs_repair(void) {
+    int saved_generations = MAX_GENERATIONS;
+    int saved_backend = EVAL_BACKEND;
+    int saved_team_mode = TEAM_MODE;
+
+    MAX_GENERATIONS = 100;
+    EVAL_BACKEND = BACKEND_THREADS;
+    TEAM_MODE = 0;
+
+    double before = 0, after = 0, ms = 0;
+    long nodes = 0;
+    int repaired_runs = 0;
+    Chromosome* repaired = alloc_population(TEAM_SIZE);
+
+    for (int r = 0; r < BENCH_REPAIR_RUNS; r++) {
+        init_robot_pool(0);
+        rng_seed(&ga_rng, 300 + r, 0);
+        fitness_cache_clear();
+        free_population(genetic_algorithm());
+
+        Chromosome team[TEAM_SIZE];
+        for (int i = 0; i < TEAM_SIZE; i++) team[i] = get_best_for_robot(i);
+        CollisionReport c = detect_collisions(team, TEAM_SIZE);
+        before += c.total_temporal_collisions + c.total_spatial_collisions + c.total_swap_conflicts;
+
+        double t0 = now_ms();
+        int ok = cbs_repair(team, TEAM_SIZE, REPAIR_DEADLINE_MS, repaired);
+        ms += now_ms() - t0;
+        nodes += cbs_nodes;
+
+        c = detect_collisions(ok ? repaired : team, TEAM_SIZE);
+        after += c.total_temporal_collisions + c.total_spatial_collisions + c.total_swap_conflicts;
+        repaired_runs += ok;
+        shutdown_robot_pool();
+    }
+    free_population(repaired);
+
+    printf("\n[bench] CBS repair of independently evolved teams (%d runs, %d generations, deadline %.0f ms)\n",
+           BENCH_REPAIR_RUNS, MAX_GENERATIONS, REPAIR_DEADLINE_MS);
+    printf("  repaired %d/%d | collisions %.1f -> %.1f per run | %.2f ms, %.0f search nodes per run\n",
+           repaired_runs, BENCH_REPAIR_RUNS, before / BENCH_REPAIR_RUNS, after / BENCH_REPAIR_RUNS,
+           ms / BENCH_REPAIR_RUNS, (double)nodes / BENCH_REPAIR_RUNS);
+
+    TEAM_MODE = saved_team_mode;
+    EVAL_BACKEND = saved_backend;
+    MAX_GENERATIONS = saved_generations;
+}
+
+// ---------- fitness kernel: one path at a time vs FITNESS_LANES in lock-step ----------
+static void bench_fitness_kernel(void) {
+    int saved_population = POPULATION_SIZE;
+    POPULATION_SIZE = BENCH_KERNEL_PATHS;
+
+    // long random walks keep the lanes busy; seeded paths are much shorter
+    Chromosome* population = alloc_population(BENCH_KERNEL_PATHS);
+    rng_seed(&ga_rng, 11, 0);
+    for (int i = 0; i < BENCH_KERNEL_PATHS; i++) create_valid_individual(&population[i]);
+    PathJob* jobs = malloc(sizeof(PathJob) * BENCH_KERNEL_PATHS);
+    double* expected = malloc(sizeof(double) * BENCH_KERNEL_PATHS);
+    if (!jobs || !expected) { perror("malloc"); exit(1); }
+
+    long genes = 0;
+    for (int i = 0; i < BENCH_KERNEL_PATHS; i++) {
+        jobs[i] = (PathJob){ .genes = population[i].genes, .length = population[i].length, .start = population[i].start, .member = -1 };
+        genes += population[i].length;
+    }
+    double total = (double)genes * BENCH_KERNEL_REPS;
+
+    printf("\n[bench] fitness kernel, %d paths x %d reps (%.0f moves/path)\n",
+           BENCH_KERNEL_PATHS, BENCH_KERNEL_REPS, (double)genes / BENCH_KERNEL_PATHS);
+
+    double t0 = now_ms();
+    for (int r = 0; r < BENCH_KERNEL_REPS; r++)
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++) {
+            int n_cp, sim;
+            expected[i] = simulate_path(jobs[i].genes, jobs[i].length, jobs[i].start,
+                                        NULL, NULL, 0, &n_cp, &sim);
+        }
+    double scalar = now_ms() - t0;
+    printf("  scalar      : %8.2f ms, %6.2f ns/move\n", scalar, scalar * 1e6 / total);
+
+    if (!simd_fitness_available() || !SIMD_FITNESS) {
+        printf("  %d-lane AVX2: off (no AVX2 or SIMD_FITNESS=0)\n", FITNESS_LANES);
+    } else {
+        t0 = now_ms();
+        for (int r = 0; r < BENCH_KERNEL_REPS; r++)
+            simulate_paths(jobs, BENCH_KERNEL_PATHS);
+        double lanes = now_ms() - t0;
+
+        int mismatches = 0;
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++)
+            if (jobs[i].fitness != expected[i]) mismatches++;
+
+        printf("  %d-lane AVX2: %8.2f ms, %6.2f ns/move  (x%.2f, %d mismatches)\n", FITNESS_LANES,
+               lanes, lanes * 1e6 / total, scalar / lanes, mismatches);
+    }
+
+    free(expected);
+    free(jobs);
+    free_population(population);
+    POPULATION_SIZE = saved_population;
+}
+
+// ---------- team exploration bits: cost in the fitness kernel ----------
+// times each kernel with no member set (nothing read) and with every path
+// scored for a member of a published team, so every first visit reads bits
+static double time_kernel(PathJob* jobs, int lanes) {
+    double ms = 0;
+    for (int r = 0; r < BENCH_KERNEL_REPS; r++) {
+        double t0 = now_ms();
+        if (lanes) {
+            simulate_paths(jobs, BENCH_KERNEL_PATHS);
+        } else {
+            for (int i = 0; i < BENCH_KERNEL_PATHS; i++) {
+                int n_cp, sim;
+                explore_member = jobs[i].member;
+                jobs[i].fitness = simulate_path(jobs[i].genes, jobs[i].length, jobs[i].start,
+                                                NULL, NULL, 0, &n_cp, &sim);
+            }
+            explore_member = -1;
+        }
+        ms += now_ms() - t0;
+    }
+    return ms;
+}
+
+static void bench_exploration_reads(void) {
+    int saved_population = POPULATION_SIZE;
+    double saved_novelty = W_NOVELTY;
+    POPULATION_SIZE = BENCH_KERNEL_PATHS;
+
+    Chromosome* population = alloc_population(BENCH_KERNEL_PATHS);
+    rng_seed(&ga_rng, 11, 0);
+    for (int i = 0; i < BENCH_KERNEL_PATHS; i++) create_valid_individual(&population[i]);
+    PathJob* jobs = malloc(sizeof(PathJob) * BENCH_KERNEL_PATHS);
+    double* plain = malloc(sizeof(double) * BENCH_KERNEL_PATHS);
+    void* bits = calloc(1, explore_bytes());
+    if (!jobs || !plain || !bits) { perror("malloc"); exit(1); }
+
+    long genes = 0;
+    for (int i = 0; i < BENCH_KERNEL_PATHS; i++) {
+        jobs[i] = (PathJob){ .genes = population[i].genes, .length = population[i].length, .start = population[i].start, .member = -1 };
+        genes += population[i].length;
+    }
+    double total = (double)genes * BENCH_KERNEL_REPS;
+
+    // the first TEAM_SIZE paths are the team
+    explore_attach(bits);
+    for (int m = 0; m < TEAM_SIZE; m++) explore_publish(m, &population[m]);
+
+    printf("\n[bench] team exploration reads in the fitness kernel, %d paths x %d reps (W_NOVELTY=0)\n",
+           BENCH_KERNEL_PATHS, BENCH_KERNEL_REPS);
+    printf("  team paths cover %ld cells, %.2f members per cell\n", explore_count(),
+           explore_count() ? (double)explore_count_members() / explore_count() : 0.0);
+
+    W_NOVELTY = 0.0;
+    int kernels = simd_fitness_available() && SIMD_FITNESS ? 2 : 1;
+    for (int lanes = 0; lanes < kernels; lanes++) {
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++) jobs[i].member = -1;
+        double off = time_kernel(jobs, lanes);
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++) plain[i] = jobs[i].fitness;
+
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++) jobs[i].member = i % TEAM_SIZE;
+        double on = time_kernel(jobs, lanes);
+
+        int changed = 0;
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++)
+            if (jobs[i].fitness != plain[i]) changed++;
+        printf("  %-11s: off %6.2f ns/move, on %6.2f ns/move (x%.2f), %d scores changed\n",
+               lanes ? "AVX2 lanes" : "scalar", off * 1e6 / total, on * 1e6 / total, on / off,
+               changed);
+    }
+
+    // with the reward on, both kernels must count the same novel cells
+    if (kernels == 2) {
+        W_NOVELTY = 1.0;
+        time_kernel(jobs, 0);
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++) plain[i] = jobs[i].fitness;
+        time_kernel(jobs, 1);
+        int mismatches = 0;
+        for (int i = 0; i < BENCH_KERNEL_PATHS; i++)
+            if (jobs[i].fitness != plain[i]) mismatches++;
+        printf("  W_NOVELTY=1: scalar vs AVX2 lanes, %d mismatches\n", mismatches);
+    }
+
+    explore_detach();
+    W_NOVELTY = saved_novelty;
+    free(bits);
+    free(plain);
+    free(jobs);
+    free_population(population);
+    POPULATION_SIZE = saved_population;
+}
+
+// ---------- migration frames: encode + decode cost per chromosome ----------
+static void bench_migration_codec(void) {
+    int saved_population = POPULATION_SIZE;
+    POPULATION_SIZE = 2;
+    rng_seed(&ga_rng, 13, 0);
+    Chromosome* pair = create_new_population();   // [0] is sent, [1] receives
+    POPULATION_SIZE = saved_population;
+
+    unsigned char* frame = malloc(NET_BUFFER_BYTES);
+    if (!frame) { perror("malloc"); exit(1); }
+    uint32_t map_id = map_fingerprint();
+
+    long bytes = 0, bad = 0;
+    double t0 = now_ms();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        uint64_t sent;
+        int size = net_encode_frame(frame, &pair[0], map_id);
+        if (net_decode_frame(frame, size, &pair[1], map_id, &sent) != size) bad++;
+        bytes += size;
+    }
+    double ms = now_ms() - t0;
+    if (!paths_are_identical(pair[0], pair[1])) bad++;
+
+    printf("\n[bench] migration frame codec (%d moves, %d bytes/frame)\n",
+           pair[0].length, (int)(bytes / BENCH_FRAMES));
+    printf("  encode+decode: %.0f ns/frame, %.1f MB/s%s\n", ms * 1e6 / BENCH_FRAMES,
+           bytes / 1e3 / ms, bad ? "  (ROUND-TRIP MISMATCH)" : "");
+    printf("  socket throughput/latency between instances: ./loopback_migration.sh\n");
+
+    free(frame);
+    free(pair);
+}
+
+// ---------- genome footprint: packed words vs one Move enum per gene ----------
+static void bench_genome_footprint(void) {
+    size_t unpacked = sizeof(Move) * (size_t)MAX_PATH_LENGTH;
+    size_t packed = sizeof(uint64_t) * GENE_WORDS(MAX_PATH_LENGTH);
+
+    printf("\n[bench] genome storage for %d moves\n", MAX_PATH_LENGTH);
+    printf("  Move[] : %8zu bytes/genome, %8zu KiB/population\n",
+           unpacked, unpacked * POPULATION_SIZE * 2 / 1024);
+    printf("  packed : %8zu bytes/genome, %8zu KiB/population  (x%.1f smaller)\n",
+           packed, packed * POPULATION_SIZE * 2 / 1024, (double)unpacked / packed);
+}
+
+// ---------- distance fields: BFS build, A* guidance, seeding ----------
+static void bench_astar_map(const char* label) {
+    Point starts[TEAM_SIZE];
+    rng_seed(&ga_rng, 17, 0);
+    for (int i = 0; i < TEAM_SIZE; i++) {
+        do {
+            starts[i] = (Point){ rng_below(&ga_rng, size_x), rng_below(&ga_rng, size_y), size_z - 1 };
+        } while (MAP_CELL(starts[i].x, starts[i].y, starts[i].z) == 1);
+    }
+
+    double t0 = now_ms();
+    distfield_bfs(survivor_cells, survivor_count, survivor_dist);
+    double field_ms = now_ms() - t0;
+
+    // exact heuristic: create_path_with_astar builds (or reuses) the
+    // target's field; then the same searches again with Manhattan
+    int goals[TEAM_SIZE];
+    long expanded = astar_expanded, moves = 0;
+    t0 = now_ms();
+    for (int i = 0; i < TEAM_SIZE; i++) {
+        Chromosome c = create_path_with_astar(starts[i]);
+        goals[i] = point_to_index(starts[i]);
+        for (int m = 0; m < c.length; m++) goals[i] += move_delta[get_move(&c, m)];
+        moves += c.length;
+        free(c.genes);
+    }
+    double exact_ms = now_ms() - t0;
+    long exact_expanded = astar_expanded - expanded;
+
+    // again, with the target fields already cached
+    t0 = now_ms();
+    for (int i = 0; i < TEAM_SIZE; i++) free(create_path_with_astar(starts[i]).genes);
+    double warm_ms = now_ms() - t0;
+
+    Move* path = malloc(sizeof(Move) * MAX_PATH_LENGTH);
+    if (!path) { perror("malloc"); exit(1); }
+    expanded = astar_expanded;
+    t0 = now_ms();
+    for (int i = 0; i < TEAM_SIZE; i++)
+        astar_search(point_to_index(starts[i]), goals[i], path, MAX_PATH_LENGTH, NULL);
+    double manhattan_ms = now_ms() - t0;
+    long manhattan_expanded = astar_expanded - expanded;
+    free(path);
+
+    printf("  %-14s | %7d | %8.3f | %9.3f %9.1f | %16.3f %8.3f %9.1f | %ld\n",
+           label, size_x * size_y * size_z, field_ms,
+           manhattan_ms / TEAM_SIZE, (double)manhattan_expanded / TEAM_SIZE,
+           exact_ms / TEAM_SIZE, warm_ms / TEAM_SIZE, (double)exact_expanded / TEAM_SIZE, moves);
+}
+
+// mean fitness of freshly seeded paths, random walk vs. distance gradient
+static void bench_seeding(void) {
+    int n = BENCH_KERNEL_PATHS;
+    Chromosome* paths = alloc_population(n);
+    PathJob* jobs = malloc(sizeof(PathJob) * n);
+    if (!jobs) { perror("malloc"); exit(1); }
+
+    printf("  seeding (%d paths) | mean fitness | mean length | reach a survivor\n", n);
+    for (int kind = 0; kind < 2; kind++) {
+        rng_seed(&ga_rng, 19, 0);
+        for (int i = 0; i < n; i++) {
+            if (kind == 0) create_valid_individual(&paths[i]);
+            else create_gradient_individual(&paths[i]);
+            jobs[i] = (PathJob){ .genes = paths[i].genes, .length = paths[i].length, .start = paths[i].start, .member = -1 };
+        }
+        simulate_paths(jobs, n);
+
+        double fitness = 0, length = 0;
+        int found = 0;
+        for (int i = 0; i < n; i++) {
+            fitness += jobs[i].fitness;
+            length += paths[i].length;
+            int end = point_to_index(paths[i].start);
+            for (int m = 0; m < paths[i].length; m++) end += move_delta[get_move(&paths[i], m)];
+            found += map_cell(end) == 2;
+        }
+        printf("  %-18s | %12.2f | %11.1f | %5.1f%%\n", kind ? "gradient" : "random walk",
+               fitness / n, length / n, 100.0 * found / n);
+    }
+
+    free(jobs);
+    free_population(paths);
+}
+
+static void bench_distance_fields(void) {
+    char big_map[] = "/tmp/rescue_bench_astar_XXXXXX";
+
+    printf("\n[bench] survivor distance fields (bit-parallel BFS) and A*, %d searches per map\n", TEAM_SIZE);
+    bench_seeding();
+
+    long dense = distfield_dense_levels, sparse = distfield_sparse_levels;
+    printf("  map            |   cells | field ms | Manhattan: ms  expanded | exact h: cold ms  warm ms  expanded | moves\n");
+    bench_astar_map("bench map");
+
+    int fd = mkstemp(big_map);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    write_random_map(big_map, 200, 200, 25, 43);
+    free_3d_map();
+    load_3d_map(big_map);
+    bench_astar_map("200 x 200 x 25");
+    unlink(big_map);
+
+    printf("  BFS levels: %ld word-parallel, %ld cell list\n",
+           distfield_dense_levels - dense, distfield_sparse_levels - sparse);
+}
+
+// ---------- paged (chunked) maps ----------
+
+// Writes a collapsed-site map: solid rubble below a quarter of the height,
+// open air above, with rubble heaps on the ground, some risk cells around
+// them and survivors lying on the ground.
+static void write_site_map(const char* path, int sx, int sy, int sz, unsigned seed) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) { perror("bench map"); exit(1); }
+
+    srand(seed);
+    int ground = sz / 4;
+    int heaps = sx * sy / 400;
+    int* heap_x = malloc(sizeof(int) * heaps * 3);
+    if (!heap_x) { perror("malloc"); exit(1); }
+    for (int i = 0; i < heaps; i++) {
+        heap_x[3 * i] = rand() % sx;
+        heap_x[3 * i + 1] = rand() % sy;
+        heap_x[3 * i + 2] = 2 + rand() % 6;   // radius
+    }
+
+    for (int z = 0; z < sz; z++) {
+        if (z > 0) fprintf(fp, "\n");
+        for (int y = 0; y < sy; y++) {
+            for (int x = 0; x < sx; x++) {
+                int cell = z < ground ? 1 : 0;
+                for (int i = 0; i < heaps && cell == 0; i++) {
+                    int d = abs(x - heap_x[3 * i]) + abs(y - heap_x[3 * i + 1]) + (z - ground);
+                    if (d < heap_x[3 * i + 2]) cell = 1;
+                    else if (d == heap_x[3 * i + 2] && rand() % 4 == 0) cell = 3;
+                }
+                if (cell == 0 && z == ground && rand() % 500 == 0) cell = 2;
+                fprintf(fp, x ? " %d" : "%d", cell);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+    free(heap_x);
+    fclose(fp);
+}
+
+#define PAGED_SEARCHES 32
+
+static void bench_paged_map(void) {
+    char text[] = "/tmp/rescue_bench_site_XXXXXX";
+    char chunked[] = "/tmp/rescue_bench_chunks_XXXXXX";
+    int fd = mkstemp(text);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    fd = mkstemp(chunked);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+
+    write_site_map(text, 256, 256, 64, 45);
+    free_3d_map();
+    load_3d_map(text);
+    chunkmap_save(chunked);
+    unlink(text);
+
+    // searches across the ground, between the heaps, to survivors
+    Point starts[PAGED_SEARCHES], goals[PAGED_SEARCHES];
+    rng_seed(&ga_rng, 19, 0);
+    for (int i = 0; i < PAGED_SEARCHES; i++) {
+        do {
+            starts[i] = (Point){ rng_below(&ga_rng, size_x), rng_below(&ga_rng, size_y), size_z / 4 };
+        } while (MAP_CELL(starts[i].x, starts[i].y, starts[i].z) == 1);
+        goals[i] = index_to_point(survivor_cells[rng_below(&ga_rng, survivor_count)]);
+    }
+
+    // dense reference: A* paths as genomes, and their fitness
+    Chromosome paths[PAGED_SEARCHES];
+    double dense_fitness[PAGED_SEARCHES];
+    Move* moves = malloc(sizeof(Move) * MAX_PATH_LENGTH);
+    if (!moves) { perror("malloc"); exit(1); }
+    astar_search(point_to_index(starts[0]), point_to_index(starts[0]), moves, 0, NULL);   // allocates its state
+    double t0 = now_ms();
+    for (int i = 0; i < PAGED_SEARCHES; i++) {
+        int n = astar_search(point_to_index(starts[i]), point_to_index(goals[i]), moves, MAX_PATH_LENGTH, NULL);
+        paths[i].genes = calloc(GENE_WORDS(n) + 1, sizeof(uint64_t));
+        if (!paths[i].genes) { perror("calloc"); exit(1); }
+        paths[i].length = n;
+        paths[i].start = starts[i];
+        for (int m = 0; m < n; m++) set_move(&paths[i], m, moves[m]);
+    }
+    double dense_astar_ms = now_ms() - t0;
+    int warm_cp, warm_sim;   // sizes the walk scratch for this map
+    simulate_path(paths[0].genes, paths[0].length, starts[0], NULL, NULL, 0, &warm_cp, &warm_sim);
+    t0 = now_ms();
+    for (int i = 0; i < PAGED_SEARCHES; i++) {
+        int cp, sim;
+        dense_fitness[i] = simulate_path(paths[i].genes, paths[i].length, starts[i], NULL, NULL, 0, &cp, &sim);
+    }
+    double dense_fitness_ms = now_ms() - t0;
+
+    struct stat st;
+    stat(chunked, &st);
+    long cells = (long)size_x * size_y * size_z;
+    printf("\n[bench] paged map, %d x %d x %d site (%ld cells, %ld KB chunked), %d A* searches + fitness\n",
+           size_x, size_y, size_z, cells, (long)st.st_size / 1024, PAGED_SEARCHES);
+    printf("  store          | A* ms | fitness ms | chunk lookups: hit %%  uniform %%  misses | matches dense\n");
+    printf("  dense grid     | %5.1f | %10.3f |                                          |\n",
+           dense_astar_ms, dense_fitness_ms);
+
+    long budgets_kb[] = { 64, 256, 1024, 16384 };
+    for (int b = 0; b < 4; b++) {
+        chunkmap_open(chunked, budgets_kb[b] * 1024);
+        int same = 1;
+        t0 = now_ms();
+        for (int i = 0; i < PAGED_SEARCHES; i++)
+            same &= astar_search_paged(starts[i], goals[i], moves, MAX_PATH_LENGTH) == paths[i].length;
+        double astar_ms = now_ms() - t0;
+        t0 = now_ms();
+        for (int i = 0; i < PAGED_SEARCHES; i++)
+            same &= simulate_path_paged(paths[i].genes, paths[i].length, starts[i]) == dense_fitness[i];
+        double fitness_ms = now_ms() - t0;
+
+        long lookups = chunk_hits + chunk_misses + chunk_uniform;
+        printf("  %5ld KB cache | %5.1f | %10.3f |          %5.1f      %5.1f  %7ld | %s\n",
+               budgets_kb[b], astar_ms, fitness_ms,
+               100.0 * chunk_hits / lookups, 100.0 * chunk_uniform / lookups, chunk_misses,
+               same ? "yes" : "NO");
+        chunkmap_close();
+    }
+
+    for (int i = 0; i < PAGED_SEARCHES; i++) free(paths[i].genes);
+    free(moves);
+    unlink(chunked);
+}
+
+// ---------- processes backend: long genomes (and their children) read in place vs copied per job ----------
+#define ARENA_PATHS 64
+#define ARENA_REPS  5
+
+static void bench_population_arena(void) {
+    char path[] = "/tmp/rescue_bench_long_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return; }
+    FILE* fp = fdopen(fd, "w");
+    if (!fp) { perror("fdopen"); exit(1); }
+
+    // one survivor in a far corner, so random walks run to the length limit
+    // (far past the old 2000-move cap on shared paths)
+    int sx = 64, sy = 64, sz = 4;
+    srand(46);
+    for (int z = 0; z < sz; z++) {
+        if (z > 0) fprintf(fp, "\n");
+        for (int y = 0; y < sy; y++) {
+            for (int x = 0; x < sx; x++) {
+                int r = rand() % 1000;
+                int cell = r < 150 ? 1 : r < 180 ? 3 : 0;
+                if (x == 0 && y == 0 && z == 0) cell = 2;
+                fprintf(fp, x ? " %d" : "%d", cell);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+    fclose(fp);
+    free_3d_map();
+    load_3d_map(path);
+    unlink(path);
+
+    int saved_backend = EVAL_BACKEND, saved_population = POPULATION_SIZE;
+    EVAL_BACKEND = BACKEND_PROCESSES;
+    POPULATION_SIZE = ARENA_PATHS;   // the arena is sized from it
+
+    // allocated before the pool: on the heap, so every job is staged
+    rng_seed(&ga_rng, 23, 0);
+    Chromosome* staged = alloc_population(ARENA_PATHS);
+    for (int i = 0; i < ARENA_PATHS; i++) {
+        staged[i].checkpoints = NULL;   // whole walks every rep
+        create_valid_individual(&staged[i]);
+    }
+    Chromosome* staged_kids = alloc_population(ARENA_PATHS);
+
+    init_robot_pool(0);
+    Chromosome* in_place = alloc_population(ARENA_PATHS);
+    Chromosome* kids = alloc_population(ARENA_PATHS);
+    Chromosome* batches[2][ARENA_PATHS];
+    EvalCheckpoint* laid[ARENA_PATHS];
+    long moves = 0, longest = 0, copied = 0;
+    for (int i = 0; i < ARENA_PATHS; i++) {
+        laid[i] = in_place[i].checkpoints;
+        in_place[i].checkpoints = NULL;
+        copy_chromosome(&in_place[i], &staged[i]);
+        batches[0][i] = &staged[i];
+        batches[1][i] = &in_place[i];
+        moves += staged[i].length;
+        copied += sizeof(uint64_t) * GENE_WORDS(staged[i].length);
+        if (staged[i].length > longest) longest = staged[i].length;
+    }
+    robot_evaluate_batch(batches[0], ARENA_PATHS);   // forks the robots
+
+    printf("\n[bench] shared population arena, %d paths of up to %ld moves (%d x %d x %d map)\n",
+           ARENA_PATHS, longest, sx, sy, sz);
+    double ms[2];
+    for (int k = 0; k < 2; k++) {
+        double t0 = now_ms();
+        for (int r = 0; r < ARENA_REPS; r++) robot_evaluate_batch(batches[k], ARENA_PATHS);
+        ms[k] = (now_ms() - t0) / ARENA_REPS;
+    }
+    int mismatches = 0;
+    for (int i = 0; i < ARENA_PATHS; i++)
+        if (staged[i].fitness != in_place[i].fitness) mismatches++;
+    printf("  staged   : %8.3f ms/batch, %6.2f ns/move (%ld KiB copied per batch)\n",
+           ms[0], ms[0] * 1e6 / moves, copied / 1024);
+    printf("  in place : %8.3f ms/batch, %6.2f ns/move (x%.2f, %d mismatches)\n",
+           ms[1], ms[1] * 1e6 / moves, ms[0] / ms[1], mismatches);
+
+    // The arena also holds each path's checkpoint cells, so a child bred in
+    // it resumes where its parent's walk left off; a staged child's cells
+    // stay on the heap and it is walked whole.
+    for (int i = 0; i < ARENA_PATHS; i++) {
+        in_place[i].checkpoints = laid[i];
+        in_place[i].checkpoint_count = 0;
+    }
+    robot_evaluate_batch(batches[1], ARENA_PATHS);
+    int kept[ARENA_PATHS];
+    for (int i = 0; i < ARENA_PATHS; i++) {
+        crossover(&in_place[i], &in_place[rng_below(&ga_rng, ARENA_PATHS)], &kids[i]);
+        mutate(&kids[i]);
+        copy_chromosome(&staged_kids[i], &kids[i]);
+        kept[i] = kids[i].checkpoint_count;
+        batches[0][i] = &staged_kids[i];
+        batches[1][i] = &kids[i];
+    }
+    for (int k = 0; k < 2; k++) {
+        double elapsed = 0;
+        for (int r = 0; r < ARENA_REPS; r++) {
+            for (int i = 0; i < ARENA_PATHS; i++) batches[k][i]->checkpoint_count = kept[i];
+            double t0 = now_ms();
+            robot_evaluate_batch(batches[k], ARENA_PATHS);
+            elapsed += now_ms() - t0;
+        }
+        ms[k] = elapsed / ARENA_REPS;
+    }
+    mismatches = 0;
+    for (int i = 0; i < ARENA_PATHS; i++)
+        if (staged_kids[i].fitness != kids[i].fitness) mismatches++;
+    printf("  children of these paths, staged   : %8.3f ms/batch (walked whole)\n", ms[0]);
+    printf("  children of these paths, in place : %8.3f ms/batch (x%.2f, resumed from their parents' "
+           "checkpoints, %d mismatches)\n", ms[1], ms[0] / ms[1], mismatches);
+
+    free_population(kids);
+    free_population(in_place);
+    shutdown_robot_pool();
+    free_population(staged_kids);
+    free_population(staged);
+    POPULATION_SIZE = saved_population;
+    EVAL_BACKEND = saved_backend;
+}
+
+// ---------- map backends: dense grid vs run-length encoded rows ----------
+
+#define BACKEND_QUERIES 1000000
+#define BACKEND_PATHS   128
+#define BACKEND_REPAIR_MOVES 20
+#define BACKEND_REPAIR_ROBOTS 3
+
+typedef struct {
+    double mb;
+    double point_ns, ray_ns, walk_ns;
+    long sum;          // of every query result, so both backends can be compared
+    double fitness;    // summed over the walks
+} BackendStats;
+
+static BackendStats measure_backend(const int* cells, Chromosome* paths, long moves) {
+    BackendStats s = { 0 };
+    s.mb = (grid ? (double)grid_cells + GRID_SLACK : (double)rle_bytes()) / (1 << 20);
+
+    double t0 = now_ms();
+    for (int i = 0; i < BACKEND_QUERIES; i++) s.sum += map_cell(cells[i]);
+    s.point_ns = (now_ms() - t0) * 1e6 / BACKEND_QUERIES;
+
+    t0 = now_ms();
+    for (int i = 0; i < BACKEND_QUERIES; i++) s.sum += map_ray_x(cells[i], i & 1 ? 1 : -1);
+    s.ray_ns = (now_ms() - t0) * 1e6 / BACKEND_QUERIES;
+
+    // scalar walks (the AVX2 kernel gathers from the dense grid only); the
+    // first round sizes the walk scratch for this map
+    for (int r = 0; r < 2; r++) {
+        s.fitness = 0;
+        t0 = now_ms();
+        for (int i = 0; i < BACKEND_PATHS; i++) {
+            int n_cp, sim;
+            s.fitness += simulate_path(paths[i].genes, paths[i].length, paths[i].start, NULL, NULL, 0, &n_cp, &sim);
+        }
+        s.walk_ns = (now_ms() - t0) * 1e6 / moves;
+    }
+    return s;
+}
+
+// CBS repair of a team that is one path BACKEND_REPAIR_ROBOTS times over,
+// so every member collides; returns whether it found a collision-free team
+static int repair_copies(const Chromosome* path, Chromosome* out) {
+    // its first BACKEND_REPAIR_MOVES moves, bits past them zero
+    Chromosome copy = *path;
+    uint64_t genes[GENE_WORDS(BACKEND_REPAIR_MOVES)] = { 0 };
+    if (copy.length > BACKEND_REPAIR_MOVES) copy.length = BACKEND_REPAIR_MOVES;
+    copy.genes = genes;
+    for (int i = 0; i < copy.length; i++) set_move(&copy, i, get_move(path, i));
+
+    Chromosome team[BACKEND_REPAIR_ROBOTS];
+    for (int i = 0; i < BACKEND_REPAIR_ROBOTS; i++) team[i] = copy;
+    return cbs_repair(team, BACKEND_REPAIR_ROBOTS, 1000.0, out);
+}
+
+static void bench_backend_map(const char* label, const char* path) {
+    int saved_backend = MAP_BACKEND;
+    MAP_BACKEND = MAP_DENSE;
+    free_3d_map();
+    load_3d_map(path);
+
+    int* cells = malloc(sizeof(int) * BACKEND_QUERIES);
+    if (!cells) { perror("malloc"); exit(1); }
+    rng_seed(&ga_rng, 23, 0);
+    for (int i = 0; i < BACKEND_QUERIES; i++)
+        cells[i] = CELL_INDEX(rng_below(&ga_rng, size_x), rng_below(&ga_rng, size_y), rng_below(&ga_rng, size_z));
+
+    Chromosome* paths = alloc_population(BACKEND_PATHS);
+    long moves = 0;
+    for (int i = 0; i < BACKEND_PATHS; i++) {
+        create_valid_individual(&paths[i]);
+        moves += paths[i].length;
+    }
+
+    Chromosome* repaired[2] = { alloc_population(BACKEND_REPAIR_ROBOTS), alloc_population(BACKEND_REPAIR_ROBOTS) };
+    int repaired_ok[2];
+
+    BackendStats dense = measure_backend(cells, paths, moves);
+    repaired_ok[0] = repair_copies(&paths[0], repaired[0]);
+    MAP_BACKEND = MAP_RLE;
+    free_3d_map();
+    load_3d_map(path);
+    BackendStats rle = measure_backend(cells, paths, moves);
+    repaired_ok[1] = repair_copies(&paths[0], repaired[1]);
+    long runs = rle_run_count();
+    MAP_BACKEND = saved_backend;
+
+    int same = dense.sum == rle.sum && dense.fitness == rle.fitness && repaired_ok[0] == repaired_ok[1];
+    for (int i = 0; i < BACKEND_REPAIR_ROBOTS && same && repaired_ok[0]; i++)
+        same = paths_are_identical(repaired[0][i], repaired[1][i]) &&
+               point_to_index(repaired[0][i].start) == point_to_index(repaired[1][i].start);
+    printf("  %-15s | dense   | %8.2f | %8.1f | %8.1f | %12.2f |\n",
+           label, dense.mb, dense.point_ns, dense.ray_ns, dense.walk_ns);
+    printf("  %-15s | rle     | %8.2f | %8.1f | %8.1f | %12.2f | %ld runs, %s, %s\n",
+           "", rle.mb, rle.point_ns, rle.ray_ns, rle.walk_ns, runs,
+           repaired_ok[1] ? "team repaired" : "no repair found",
+           same ? "same results" : "MISMATCH");
+
+    free_population(repaired[0]);
+    free_population(repaired[1]);
+    free_population(paths);
+    free(cells);
+}
+
+static void bench_map_backends(void) {
+    char site[] = "/tmp/rescue_bench_site_XXXXXX";
+    char noise[] = "/tmp/rescue_bench_noise_XXXXXX";
+    int fd = mkstemp(site);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    fd = mkstemp(noise);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    write_site_map(site, 256, 256, 64, 45);
+    write_random_map(noise, 200, 200, 25, 43);
+
+    printf("\n[bench] map backends: %d random cell / x-ray queries, %d random walks, "
+           "CBS repair of one walk %d times over\n", BACKEND_QUERIES, BACKEND_PATHS, BACKEND_REPAIR_ROBOTS);
+    printf("  map             | backend |       MB | point ns |   ray ns | walk ns/move |\n");
+    bench_backend_map("site 256^2x64", site);
+    bench_backend_map("random 200^2x25", noise);
+
+    unlink(site);
+    unlink(noise);
+}
+
+// ---------- team exploration: publishing a member's new best ----------
+#define PUBLISH_PATHS 512
+#define PUBLISH_MOVES 1000   // GA bests are far shorter than the map is large
+
+static void bench_exploration_publish(void) {
+    char site[] = "/tmp/rescue_bench_explore_XXXXXX";
+    int fd = mkstemp(site);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    write_site_map(site, 256, 256, 64, 45);
+    free_3d_map();
+    load_3d_map(site);
+
+    Chromosome* paths = alloc_population(PUBLISH_PATHS);
+    rng_seed(&ga_rng, 29, 0);
+    long moves = 0;
+    for (int i = 0; i < PUBLISH_PATHS; i++) {
+        create_valid_individual(&paths[i]);
+        if (paths[i].length > PUBLISH_MOVES) paths[i].length = PUBLISH_MOVES;
+        moves += paths[i].length;
+    }
+    void* bits = calloc(1, explore_bytes());
+    if (!bits) { perror("calloc"); exit(1); }
+    explore_attach(bits);
+
+    // the members take turns getting a new best, as in the GA
+    double t0 = now_ms();
+    for (int i = 0; i < PUBLISH_PATHS; i++) explore_publish(i % TEAM_SIZE, &paths[i]);
+    double ms = now_ms() - t0;
+
+    printf("\n[bench] team exploration: %d new bests published on a 256 x 256 x 64 map, "
+           "%ld moves per path on average\n", PUBLISH_PATHS, moves / PUBLISH_PATHS);
+    printf("  %.2f us per publish, team paths cover %ld cells\n", ms * 1000.0 / PUBLISH_PATHS,
+           explore_count());
+
+    explore_detach();
+    free(bits);
+    free_population(paths);
+    unlink(site);
+}
+
+// ---------- incremental evaluation: children resuming from their parent's checkpoints ----------
+#define RESUME_PARENTS 64
+#define RESUME_REPS    5
+
+static void bench_incremental_eval(void) {
+    char site[] = "/tmp/rescue_bench_resume_XXXXXX";
+    int fd = mkstemp(site);
+    if (fd < 0) { perror("mkstemp"); return; }
+    close(fd);
+    write_site_map(site, 256, 256, 64, 45);
+    free_3d_map();
+    load_3d_map(site);
+
+    // parents are scored once, which lays their checkpoints and cells
+    rng_seed(&ga_rng, 31, 0);
+    Chromosome* parents = alloc_population(RESUME_PARENTS);
+    Chromosome* resumed = alloc_population(RESUME_PARENTS);
+    Chromosome* whole = alloc_population(RESUME_PARENTS);
+    PathJob jobs[RESUME_PARENTS];
+    for (int i = 0; i < RESUME_PARENTS; i++) {
+        create_valid_individual(&parents[i]);
+        jobs[i] = (PathJob){ .genes = parents[i].genes, .length = parents[i].length,
+                             .start = parents[i].start, .checkpoints = parents[i].checkpoints,
+                             .cells = parents[i].cells, .member = -1 };
+    }
+    simulate_paths(jobs, RESUME_PARENTS);
+    for (int i = 0; i < RESUME_PARENTS; i++) parents[i].checkpoint_count = jobs[i].checkpoint_count;
+
+    // breeding as in the GA: what it costs now includes copying the kept cells
+    double t0 = now_ms();
+    for (int i = 0; i < RESUME_PARENTS; i++) {
+        crossover(&parents[i], &parents[rng_below(&ga_rng, RESUME_PARENTS)], &resumed[i]);
+        mutate(&resumed[i]);
+    }
+    double breed_ms = now_ms() - t0;
+
+    long moves = 0;
+    for (int i = 0; i < RESUME_PARENTS; i++) {
+        copy_chromosome(&whole[i], &resumed[i]);
+        whole[i].checkpoint_count = 0;
+        moves += resumed[i].length;
+    }
+
+    // every rep starts from the same checkpoints; both sides lay new ones
+    Chromosome* sets[2] = { whole, resumed };
+    double ms[2], fitness[2][RESUME_PARENTS];
+    long walked[2] = { 0, 0 };
+    for (int k = 0; k < 2; k++) {
+        Chromosome* c = sets[k];
+        double elapsed = 0;
+        for (int r = 0; r < RESUME_REPS; r++) {
+            for (int i = 0; i < RESUME_PARENTS; i++)
+                jobs[i] = (PathJob){ .genes = c[i].genes, .length = c[i].length, .start = c[i].start,
+                                     .checkpoints = c[i].checkpoints, .cells = c[i].cells,
+                                     .resume_count = c[i].checkpoint_count, .member = -1 };
+            t0 = now_ms();
+            simulate_paths(jobs, RESUME_PARENTS);
+            elapsed += now_ms() - t0;
+        }
+        ms[k] = elapsed / RESUME_REPS;
+        for (int i = 0; i < RESUME_PARENTS; i++) {
+            fitness[k][i] = jobs[i].fitness;
+            walked[k] += jobs[i].simulated;
+        }
+    }
+    int mismatches = 0;
+    for (int i = 0; i < RESUME_PARENTS; i++)
+        if (fitness[0][i] != fitness[1][i]) mismatches++;
+
+    printf("\n[bench] incremental evaluation: %d children of random walks on a 256 x 256 x 64 map, "
+           "%ld moves per child on average (many hit an obstacle soon after the cut)\n",
+           RESUME_PARENTS, moves / RESUME_PARENTS);
+    printf("  whole walks : %8.3f ms per batch, %8ld moves walked\n", ms[0], walked[0]);
+    printf("  resumed     : %8.3f ms per batch, %8ld moves walked (x%.2f, %d mismatches), breeding %.3f ms\n",
+           ms[1], walked[1], ms[0] / ms[1], mismatches, breed_ms);
+
+    free_population(parents);
+    free_population(resumed);
+    free_population(whole);
+    unlink(site);
+}
+
+// FNV-1a over the padded grid, to check every format loads the same map
+static unsigned long long grid_checksum(void) {
+    unsigned long long h = 1469598103934665603ull;
+    for (int i = 0; i < grid_cells; i++) { h ^= map_cell(i); h *= 1099511628211ull; }
+    return h;
+}
+
+static double time_map_load(const char* path, unsigned long long* checksum) {
+    free_3d_map();
+    double best = 1e18;
+    for (int r = 0; r < 3; r++) {
+        double t0 = now_ms();
+        load_3d_map(path);
+        double t = now_ms() - t0;
+        if (t < best) best = t;
+        if (r < 2) free_3d_map();
+    }
+    *checksum = grid_checksum();
+    return best;
+}
+
+static void bench_map_loading(void) {
+    char text[] = "/tmp/rescue_bench_text_XXXXXX";
+    char vox[] = "/tmp/rescue_bench_vox_XXXXXX";
+    char vox2[] = "/tmp/rescue_bench_vox2_XXXXXX";
+    char* paths[3] = { text, vox, vox2 };
+    const char* labels[3] = { "text", ".vox bytes", ".vox 2-bit" };
+
+    for (int i = 0; i < 3; i++) {
+        int fd = mkstemp(paths[i]);
+        if (fd < 0) { perror("mkstemp"); return; }
+        close(fd);
+    }
+    write_random_map(text, 200, 200, 50, 44);
+    free_3d_map();
+    load_3d_map(text);
+    save_vox(vox, 0);
+    save_vox(vox2, 1);
+
+    // the survivor distance field is built by every load: time it on its own
+    double t0 = now_ms();
+    distfield_build(NULL, 0);
+    double field_ms = now_ms() - t0;
+
+    printf("\n[bench] map loading, 200 x 200 x 50 (%d cells), best of 3 (distance field from a grid scan alone: %.1f ms)\n",
+           size_x * size_y * size_z, field_ms);
+    printf("  format      |  file KB | load ms | checksum\n");
+    unsigned long long first = 0;
+    for (int i = 0; i < 3; i++) {
+        struct stat st;
+        stat(paths[i], &st);
+        unsigned long long sum;
+        double ms = time_map_load(paths[i], &sum);
+        if (i == 0) first = sum;
+        printf("  %-11s | %8ld | %7.1f | %016llx%s\n", labels[i], (long)st.st_size / 1024, ms, sum,
+               sum == first ? "" : "  MISMATCH");
+        unlink(paths[i]);
+    }
+}
+
+int run_benchmarks(const char* map_file) {
+    char tmp_map[] = "/tmp/rescue_bench_XXXXXX";
+
+    if (!map_file) {
+        int fd = mkstemp(tmp_map);
+        if (fd < 0) { perror("mkstemp"); return 1; }
+        close(fd);
+        write_random_map(tmp_map, 20, 20, 4, 42);
+        map_file = tmp_map;
+    }
+
+    load_3d_map(map_file);
+    printf("[bench] map %s: %d x %d x %d\n", map_file, size_x, size_y, size_z);
+
+    bench_genome_footprint();
+    bench_ipc_latency();
+    bench_fitness_kernel();
+    bench_exploration_reads();
+    bench_migration_codec();
+    bench_generation_scaling();
+    bench_elastic_pool();
+    bench_seeding_convergence();
+    bench_island_scaling();
+    bench_selection_scaling();
+    bench_collision_scaling();
+    bench_team_coevolution();
+    bench_cbs_repair();
+    bench_distance_fields();   // last: they replace the loaded map
+    bench_paged_map();
+    bench_population_arena();
+    bench_map_backends();
+    bench_exploration_publish();
+    bench_incremental_eval();
+    bench_map_loading();
+
+    free_3d_map();
+    if (map_file == tmp_map) unlink(tmp_map);
+    return 0;
+}
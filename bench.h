@@ -0,0 +1,7 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Runs the performance benchmarks on map_file, or on a generated map when NULL.
+int run_benchmarks(const char* map_file);
+
+#endif
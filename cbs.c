@@ -0,0 +1,502 @@
+//cbs.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cbs.h"
+#include "distfield.h"
+#include "spacetime.h"
+
+// how many moves longer than its shortest path a replanned path may get
+// while it goes around the cells and moments forbidden to it
+#define CBS_SLACK 32
+// low-level expansions between two looks at the clock
+#define CBS_CLOCK_EVERY 1024
+
+#define PLAN_INFEASIBLE -1
+#define PLAN_TIMEOUT    -2
+
+enum { FORBID_CELL, FORBID_VERTEX, FORBID_EDGE };
+
+typedef struct {
+    int kind;
+    int cell;   // FORBID_EDGE: the cell the move leaves
+    int t;      // FORBID_VERTEX, FORBID_EDGE
+    int move;   // FORBID_EDGE
+} Constraint;
+
+typedef struct {
+    int a, b;
+    Constraint for_a, for_b;
+} Conflict;
+
+typedef struct {
+    int parent;              // -1 at the root
+    int robot;               // robot constrained and replanned here
+    Constraint constraint;
+    int start;               // its start (moved if the old one is forbidden)
+    long path;               // its new moves in move_pool
+    int length;
+    long cost;               // sum of all path lengths
+    int conflicts;           // colliding pairs / cell visits left
+    Conflict first;          // the one to split on, see find_conflict
+} CbsNode;
+
+typedef struct {
+    int start;
+    long moves;   // offset in move_pool
+    int length;
+} PathView;
+
+typedef struct {
+    int cell, t, parent;
+    int f;
+    uint8_t move;
+} LowState;
+
+long cbs_nodes = 0;
+int cbs_replanned = 0;
+
+static CbsNode* nodes = NULL;
+static int node_count = 0, node_capacity = 0;
+static int* open_nodes = NULL;    // binary heap of node indices, see node_before
+static int open_count = 0;
+
+static uint8_t* move_pool = NULL;
+static long pool_used = 0, pool_capacity = 0;
+
+static LowState* states = NULL;   // low-level search, reused by every plan
+static int state_capacity = 0;
+static int* open_states = NULL;
+
+// scratch tables are never cleared: an entry only counts if its `a` holds
+// the current epoch, which every conflict scan and every plan bumps
+static SpaceTimeTable occupied, cells, edges, visited;
+static int epoch = 0;
+// the constraints on the robot being replanned, by kind
+static SpaceTimeTable forbid_cells, forbid_vertices, forbid_edges;
+static struct timespec started;
+static double deadline;
+
+static void* cbs_realloc(void* p, size_t size) {
+    p = realloc(p, size);
+    if (!p) { perror("realloc"); exit(1); }
+    return p;
+}
+
+static double elapsed_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - started.tv_sec) * 1000.0 + (now.tv_nsec - started.tv_nsec) / 1e6;
+}
+
+static long pool_reserve(long moves) {
+    if (pool_used + moves > pool_capacity) {
+        while (pool_used + moves > pool_capacity) pool_capacity = pool_capacity ? 2 * pool_capacity : 4096;
+        move_pool = cbs_realloc(move_pool, pool_capacity);
+    }
+    long at = pool_used;
+    pool_used += moves;
+    return at;
+}
+
+/* ---- high-level open list ---- */
+
+// fewest conflicts first, then the shortest paths: a repair only needs some
+// collision-free team before the deadline, not the shortest one
+static int node_before(int a, int b) {
+    if (nodes[a].conflicts != nodes[b].conflicts) return nodes[a].conflicts < nodes[b].conflicts;
+    return nodes[a].cost < nodes[b].cost || (nodes[a].cost == nodes[b].cost && a > b);
+}
+
+static void open_push(int node) {
+    int i = open_count++;
+    while (i > 0 && node_before(node, open_nodes[(i - 1) / 2])) {
+        open_nodes[i] = open_nodes[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    open_nodes[i] = node;
+}
+
+static int open_pop(void) {
+    int top = open_nodes[0];
+    int last = open_nodes[--open_count];
+    int i = 0;
+    while (1) {
+        int c = 2 * i + 1;
+        if (c >= open_count) break;
+        if (c + 1 < open_count && node_before(open_nodes[c + 1], open_nodes[c])) c++;
+        if (!node_before(open_nodes[c], last)) break;
+        open_nodes[i] = open_nodes[c];
+        i = c;
+    }
+    open_nodes[i] = last;
+    return top;
+}
+
+static int new_node(void) {
+    if (node_count == node_capacity) {
+        node_capacity = node_capacity ? 2 * node_capacity : 256;
+        nodes = cbs_realloc(nodes, sizeof(CbsNode) * node_capacity);
+        open_nodes = cbs_realloc(open_nodes, sizeof(int) * node_capacity);
+    }
+    return node_count++;
+}
+
+/* ---- paths and conflicts of a node ---- */
+
+// every robot walks its root path unless the node or an ancestor replanned it
+static void node_paths(int node, const PathView* root, int n, PathView* view, int* replanned) {
+    for (int r = 0; r < n; r++) {
+        view[r] = root[r];
+        replanned[r] = 0;
+    }
+    for (int i = node; nodes[i].parent >= 0; i = nodes[i].parent) {
+        int r = nodes[i].robot;
+        if (replanned[r]) continue;
+        view[r].start = nodes[i].start;
+        view[r].moves = nodes[i].path;
+        view[r].length = nodes[i].length;
+        replanned[r] = 1;
+    }
+}
+
+// Counts the conflicts between the paths, by the rules of detect_collisions()
+// (a robot entering a cell another one uses counts at every visit), and
+// stores the first one: a temporal one if any, else a swap, else a shared cell.
+static int find_conflict(const PathView* view, int n, Conflict* out) {
+    int count = 0;
+    Conflict temporal, swap, shared;
+    int found_temporal = 0, found_swap = 0, found_shared = 0;
+
+    epoch++;
+    for (int r = 0; r < n; r++) {
+        const uint8_t* moves = move_pool + view[r].moves;
+        int idx = view[r].start;
+
+        for (int t = 0; ; t++) {
+            SpaceTimeEntry* e;
+            if (t < view[r].length) {
+                e = st_insert(&occupied, st_key(idx, t));
+                if (e->a != epoch) {
+                    e->a = epoch;
+                    e->b = r + 1;
+                } else {
+                    count++;
+                    if (!found_temporal) {
+                        Constraint c = { FORBID_VERTEX, idx, t, 0 };
+                        temporal = (Conflict){ e->b - 1, r, c, c };
+                        found_temporal = 1;
+                    }
+                }
+            }
+
+            e = st_insert(&cells, st_key(idx, 0));
+            if (e->a != epoch) {
+                e->a = epoch;
+                e->b = r + 1;
+            } else if (e->b != r + 1) {
+                count++;
+                if (!found_shared) {
+                    Constraint c = { FORBID_CELL, idx, 0, 0 };
+                    shared = (Conflict){ e->b - 1, r, c, c };
+                    found_shared = 1;
+                }
+            }
+
+            if (t == view[r].length) break;
+            int m = moves[t];
+            int next = idx + move_delta[m];
+            if (map_cell(next) == 1) break;
+
+            e = st_find(&edges, st_edge_key(next, t, m ^ 1));
+            if (e && e->a == epoch) {
+                count++;
+                if (!found_swap) {
+                    Constraint ca = { FORBID_EDGE, next, t, m ^ 1 };
+                    Constraint cb = { FORBID_EDGE, idx, t, m };
+                    swap = (Conflict){ e->b - 1, r, ca, cb };
+                    found_swap = 1;
+                }
+            }
+            e = st_insert(&edges, st_edge_key(idx, t, m));
+            e->a = epoch;
+            e->b = r + 1;
+
+            idx = next;
+        }
+    }
+
+    if (found_temporal) *out = temporal;
+    else if (found_swap) *out = swap;
+    else if (found_shared) *out = shared;
+    return count;
+}
+
+/* ---- low level: space-time A* for one robot ---- */
+
+static inline int cell_forbidden(int cell) {
+    return st_find(&forbid_cells, st_key(cell, 0)) != NULL;
+}
+
+static inline int vertex_forbidden(int cell, int t) {
+    return st_find(&forbid_vertices, st_key(cell, t)) != NULL;
+}
+
+static inline int edge_forbidden(int cell, int t, int move) {
+    return st_find(&forbid_edges, st_edge_key(cell, t, move)) != NULL;
+}
+
+static int state_before(int a, int b) {
+    return states[a].f < states[b].f || (states[a].f == states[b].f && states[a].t > states[b].t);
+}
+
+static void state_push(int s, int* count) {
+    int i = (*count)++;
+    while (i > 0 && state_before(s, open_states[(i - 1) / 2])) {
+        open_states[i] = open_states[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    open_states[i] = s;
+}
+
+static int state_pop(int* count) {
+    int top = open_states[0];
+    int last = open_states[--(*count)];
+    int i = 0;
+    while (1) {
+        int c = 2 * i + 1;
+        if (c >= *count) break;
+        if (c + 1 < *count && state_before(open_states[c + 1], open_states[c])) c++;
+        if (!state_before(open_states[c], last)) break;
+        open_states[i] = open_states[c];
+        i = c;
+    }
+    open_states[i] = last;
+    return top;
+}
+
+static int new_state(int cell, int t, int parent, int move, int f) {
+    static int used = 0;
+    if (parent < 0) used = 0;   // the start state begins a new search
+    if (used == state_capacity) {
+        state_capacity = state_capacity ? 2 * state_capacity : 4096;
+        states = cbs_realloc(states, sizeof(LowState) * state_capacity);
+        open_states = cbs_realloc(open_states, sizeof(int) * state_capacity);
+    }
+    states[used] = (LowState){ cell, t, parent, f, (uint8_t)move };
+    return used++;
+}
+
+// Robots start anywhere on the top floor, so one whose start is forbidden
+// (it shares it with another) moves to the nearest open top-floor cell.
+static int free_start(int start, const int32_t* h) {
+    if (!cell_forbidden(start) && !vertex_forbidden(start, 0)) return start;
+
+    Point from = index_to_point(start);
+    int best = -1, best_dist = 0;
+    for (int y = 0; y < size_y; y++) {
+        for (int x = 0; x < size_x; x++) {
+            int cell = point_to_index((Point){ x, y, size_z - 1 });
+            if (map_cell(cell) == 1 || h[cell] == DIST_UNREACHABLE) continue;
+            if (cell_forbidden(cell) || vertex_forbidden(cell, 0)) continue;
+            int dist = abs(x - from.x) + abs(y - from.y) + abs(size_z - 1 - from.z);
+            if (best < 0 || dist < best_dist) {
+                best = cell;
+                best_dist = dist;
+            }
+        }
+    }
+    return best;
+}
+
+// Shortest path to goal that breaks none of the robot's constraints, written to
+// move_pool; returns its length, offset and start (see free_start), or
+// PLAN_INFEASIBLE / PLAN_TIMEOUT. If the goal cell itself is forbidden the
+// path ends next to it. A robot leaves the map once it arrives, so its last
+// cell is not checked against (cell, t) constraints, as in detect_collisions().
+static int plan(int* start, int goal, long* at) {
+    const int32_t* h = distfield_from(goal);
+    int from = free_start(*start, h);
+    if (from < 0 || h[from] == DIST_UNREACHABLE) return PLAN_INFEASIBLE;
+    *start = from;
+
+    int goal_open = !cell_forbidden(goal);
+    int horizon = h[from] + CBS_SLACK;
+    if (horizon > MAX_PATH_LENGTH) horizon = MAX_PATH_LENGTH;
+
+    epoch++;
+    int count = 0, expanded = 0;
+    state_push(new_state(from, 0, -1, 0, h[from]), &count);
+    st_insert(&visited, st_key(from, 0))->a = epoch;
+
+    while (count > 0) {
+        int s = state_pop(&count);
+        int cell = states[s].cell, t = states[s].t;
+
+        if (goal_open ? cell == goal : h[cell] <= 1) {
+            *at = pool_reserve(t);
+            for (int i = s, j = t - 1; j >= 0; i = states[i].parent, j--)
+                move_pool[*at + j] = states[i].move;
+            return t;
+        }
+
+        if (++expanded % CBS_CLOCK_EVERY == 0 && elapsed_ms() > deadline) return PLAN_TIMEOUT;
+
+        for (int m = 0; m < 6; m++) {
+            int next = cell + move_delta[m];
+            if (map_cell(next) == 1 || h[next] == DIST_UNREACHABLE) continue;
+            if (t + 1 + h[next] > horizon) continue;
+            if (cell_forbidden(next) || edge_forbidden(cell, t, m)) continue;
+            // the cell the path may end in is not held at t + 1
+            int last = goal_open ? next == goal : h[next] <= 1;
+            if (!last && vertex_forbidden(next, t + 1)) continue;
+
+            SpaceTimeEntry* e = st_insert(&visited, st_key(next, t + 1));
+            if (e->a == epoch) continue;
+            e->a = epoch;
+            state_push(new_state(next, t + 1, s, m, t + 1 + h[next]), &count);
+        }
+    }
+    return PLAN_INFEASIBLE;
+}
+
+static void forbid(const Constraint* c) {
+    if (c->kind == FORBID_CELL) st_insert(&forbid_cells, st_key(c->cell, 0));
+    else if (c->kind == FORBID_VERTEX) st_insert(&forbid_vertices, st_key(c->cell, c->t));
+    else st_insert(&forbid_edges, st_edge_key(c->cell, c->t, c->move));
+}
+
+// loads the constraints node and its ancestors put on robot, plus extra
+static void gather_constraints(int node, int robot, const Constraint* extra) {
+    st_clear(&forbid_cells);
+    st_clear(&forbid_vertices);
+    st_clear(&forbid_edges);
+    for (int i = node; nodes[i].parent >= 0; i = nodes[i].parent)
+        if (nodes[i].robot == robot) forbid(&nodes[i].constraint);
+    forbid(extra);
+}
+
+static void cbs_release(void) {
+    free(nodes);
+    free(open_nodes);
+    free(move_pool);
+    free(states);
+    free(open_states);
+    nodes = NULL;
+    open_nodes = NULL;
+    move_pool = NULL;
+    states = NULL;
+    open_states = NULL;
+    node_count = node_capacity = open_count = 0;
+    pool_used = pool_capacity = 0;
+    state_capacity = 0;
+    st_free(&occupied);
+    st_free(&cells);
+    st_free(&edges);
+    st_free(&visited);
+    st_free(&forbid_cells);
+    st_free(&forbid_vertices);
+    st_free(&forbid_edges);
+}
+
+int cbs_repair(const Chromosome* team, int n, double deadline_ms, Chromosome* out) {
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    deadline = deadline_ms;
+    cbs_nodes = 0;
+    cbs_replanned = 0;
+
+    PathView* root = malloc(sizeof(PathView) * n);
+    PathView* view = malloc(sizeof(PathView) * n);
+    PathView* child_view = malloc(sizeof(PathView) * n);
+    int* replanned = malloc(sizeof(int) * n);
+    int* goal = malloc(sizeof(int) * n);   // where each evolved path ends
+    if (!root || !view || !child_view || !replanned || !goal) { perror("malloc"); exit(1); }
+
+    // root: the evolved paths, cut where they would run into an obstacle
+    long total = 0;
+    for (int r = 0; r < n; r++) {
+        root[r].start = point_to_index(team[r].start);
+        root[r].moves = pool_reserve(team[r].length);
+        int idx = root[r].start, len = 0;
+        while (len < team[r].length) {
+            int m = get_move(&team[r], len);
+            if (map_cell(idx + move_delta[m]) == 1) break;
+            move_pool[root[r].moves + len++] = (uint8_t)m;
+            idx += move_delta[m];
+        }
+        root[r].length = len;
+        goal[r] = idx;
+        total += len + 1;
+    }
+
+    st_init(&occupied, total);
+    st_init(&cells, total);
+    st_init(&edges, total);
+    st_init(&visited, 1024);
+    st_init(&forbid_cells, 64);
+    st_init(&forbid_vertices, 64);
+    st_init(&forbid_edges, 64);
+
+    int r0 = new_node();
+    nodes[r0] = (CbsNode){ .parent = -1, .robot = -1, .cost = total - n };
+    nodes[r0].conflicts = find_conflict(root, n, &nodes[r0].first);
+    open_push(r0);
+
+    int solved = -1;
+    while (open_count > 0 && elapsed_ms() <= deadline) {
+        int node = open_pop();
+        cbs_nodes++;
+        if (nodes[node].conflicts == 0) {
+            solved = node;
+            break;
+        }
+
+        // one child forbids the conflict to each of the two robots
+        node_paths(node, root, n, view, replanned);
+        Conflict conflict = nodes[node].first;
+        for (int side = 0; side < 2; side++) {
+            int robot = side ? conflict.b : conflict.a;
+            const Constraint* rule = side ? &conflict.for_b : &conflict.for_a;
+            gather_constraints(node, robot, rule);
+
+            long at = 0;
+            int start = view[robot].start;
+            int length = plan(&start, goal[robot], &at);
+            if (length == PLAN_TIMEOUT) break;
+            if (length == PLAN_INFEASIBLE) continue;
+
+            int child = new_node();
+            nodes[child] = (CbsNode){ node, robot, *rule, start, at, length,
+                                      nodes[node].cost - view[robot].length + length, 0, conflict };
+            node_paths(child, root, n, child_view, replanned);
+            nodes[child].conflicts = find_conflict(child_view, n, &nodes[child].first);
+            open_push(child);
+        }
+    }
+
+    if (solved >= 0) {
+        node_paths(solved, root, n, view, replanned);
+        for (int r = 0; r < n; r++) {
+            if (!replanned[r]) {
+                copy_chromosome(&out[r], &team[r]);
+                continue;
+            }
+            cbs_replanned++;
+            out[r].start = index_to_point(view[r].start);
+            out[r].length = view[r].length;
+            out[r].checkpoint_count = 0;
+            memset(out[r].genes, 0, sizeof(uint64_t) * GENE_WORDS(view[r].length));
+            for (int t = 0; t < view[r].length; t++)
+                set_move(&out[r], t, (Move)move_pool[view[r].moves + t]);
+        }
+    }
+
+    free(root);
+    free(view);
+    free(child_view);
+    free(replanned);
+    free(goal);
+    cbs_release();
+    return solved >= 0;
+}
@@ -0,0 +1,26 @@
+//cbs.h
+// Conflict-Based Search repair of a finished team. Every robot keeps its
+// start and the cell its evolved path ends in, unless it shares them with
+// another robot: then it starts from the nearest open top-floor cell or
+// ends next to its end cell. The high level is a
+// best-first search over constraint sets, cheapest total path length first,
+// starting from the evolved paths themselves: a node's first conflict splits
+// it in two, forbidding the conflict to one robot or to the other, and only
+// that robot is replanned, by a space-time A* that honours its constraints.
+#ifndef CBS_H
+#define CBS_H
+
+#include "genetic.h"
+
+extern double REPAIR_DEADLINE_MS;   // config; 0 turns the repair off
+
+extern long cbs_nodes;      // high-level nodes expanded by the last repair
+extern int cbs_replanned;   // robots whose path the last repair changed
+
+// Writes a collision-free version of team[0..n-1] (no temporal, swap or
+// shared-cell conflict, as detect_collisions() counts them) into out, whose
+// genes need MAX_PATH_LENGTH room, and returns 1. Returns 0 if there is none
+// or it was not found within deadline_ms. Fitness is left to the caller.
+int cbs_repair(const Chromosome* team, int n, double deadline_ms, Chromosome* out);
+
+#endif
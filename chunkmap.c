@@ -0,0 +1,244 @@
+//chunkmap.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chunkmap.h"
+
+long chunk_hits = 0, chunk_misses = 0, chunk_uniform = 0;
+int chunk_size_x = 0, chunk_size_y = 0, chunk_size_z = 0;
+int chunk_count_x = 0, chunk_count_y = 0;
+long chunk_last = -1;
+const uint8_t* chunk_last_cells = NULL;
+
+static uint8_t* file_map = NULL;
+static size_t file_len = 0;
+static const uint32_t* directory = NULL;
+static const uint8_t* pages = NULL;
+static int drop_pages = 0;          // chunk pages can be handed back one by one
+
+// LRU cache: slots of CHUNK_CELLS bytes, most recently used at lru_head
+static int slots = 0, slots_used = 0;
+static uint8_t* pool = NULL;
+static long* slot_chunk = NULL;     // chunk held by each slot
+static int* lru_prev = NULL;
+static int* lru_next = NULL;
+static int lru_head = -1, lru_tail = -1;
+static int* chunk_slot = NULL;      // per chunk: its slot, or -1 (4 bytes per 4096 cells)
+
+static void* chunk_malloc(size_t size) {
+    void* p = malloc(size);
+    if (!p) { perror("malloc"); exit(1); }
+    return p;
+}
+
+// ---------- writing ----------
+
+// copies chunk (cx, cy, cz) of the loaded grid into cells, cells past the map
+// edge as obstacle; returns the value if all cells are the same, else -1
+static int gather_chunk(int cx, int cy, int cz, uint8_t* cells) {
+    int x0 = cx * CHUNK_SIDE, y0 = cy * CHUNK_SIDE, z0 = cz * CHUNK_SIDE;
+    int uniform = -2;
+    int i = 0;
+    for (int z = z0; z < z0 + CHUNK_SIDE; z++)
+        for (int y = y0; y < y0 + CHUNK_SIDE; y++)
+            for (int x = x0; x < x0 + CHUNK_SIDE; x++, i++) {
+                uint8_t v = (x < size_x && y < size_y && z < size_z) ? MAP_CELL(x, y, z) : 1;
+                cells[i] = v;
+                if (uniform == -2) uniform = v;
+                else if (uniform != v) uniform = -1;
+            }
+    return uniform;
+}
+
+void chunkmap_save(const char* filename) {
+    int cx = (size_x + CHUNK_SIDE - 1) / CHUNK_SIDE;
+    int cy = (size_y + CHUNK_SIDE - 1) / CHUNK_SIDE;
+    int cz = (size_z + CHUNK_SIDE - 1) / CHUNK_SIDE;
+    long count = (long)cx * cy * cz;
+    uint8_t cells[CHUNK_CELLS];
+
+    uint32_t* dir = chunk_malloc(sizeof(uint32_t) * count);
+    uint64_t stored = 0;
+    long c = 0;
+    for (int z = 0; z < cz; z++)
+        for (int y = 0; y < cy; y++)
+            for (int x = 0; x < cx; x++, c++) {
+                int v = gather_chunk(x, y, z, cells);
+                dir[c] = v >= 0 ? CHUNK_UNIFORM(v) : (uint32_t)stored++;
+            }
+
+    ChunkHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHUNK_MAGIC, 4);
+    h.version = CHUNK_VERSION;
+    h.size_x = size_x; h.size_y = size_y; h.size_z = size_z;
+    h.chunks_x = cx; h.chunks_y = cy; h.chunks_z = cz;
+    h.stored_chunks = stored;
+    h.data_offset = (sizeof(h) + sizeof(uint32_t) * count + CHUNK_CELLS - 1) & ~(uint64_t)(CHUNK_CELLS - 1);
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) { perror("Cannot write map"); exit(1); }
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(dir, sizeof(uint32_t), count, fp);
+    static const uint8_t zeros[CHUNK_CELLS];
+    fwrite(zeros, 1, h.data_offset - sizeof(h) - sizeof(uint32_t) * count, fp);
+
+    c = 0;
+    for (int z = 0; z < cz; z++)
+        for (int y = 0; y < cy; y++)
+            for (int x = 0; x < cx; x++, c++)
+                if (!CHUNK_IS_UNIFORM(dir[c])) {
+                    gather_chunk(x, y, z, cells);
+                    fwrite(cells, 1, CHUNK_CELLS, fp);
+                }
+
+    free(dir);
+    if (fclose(fp) != 0) { perror("Cannot write map"); exit(1); }
+}
+
+// ---------- paged reading ----------
+
+void chunkmap_open(const char* filename, long budget_bytes) {
+    chunkmap_close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) { perror("Cannot open map"); exit(1); }
+    struct stat st;
+    if (fstat(fd, &st) < 0) { perror("fstat"); exit(1); }
+    file_len = st.st_size;
+    if (file_len < sizeof(ChunkHeader)) {
+        fprintf(stderr, "Not a chunked map: '%s'\n", filename);
+        exit(1);
+    }
+    file_map = mmap(NULL, file_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (file_map == MAP_FAILED) { perror("mmap"); exit(1); }
+    close(fd);
+
+    const ChunkHeader* h = (const ChunkHeader*)file_map;
+    long count = (long)h->chunks_x * h->chunks_y * h->chunks_z;
+    if (memcmp(h->magic, CHUNK_MAGIC, 4) != 0 || h->version != CHUNK_VERSION ||
+        h->chunks_x != (h->size_x + CHUNK_SIDE - 1) / CHUNK_SIDE ||
+        h->chunks_y != (h->size_y + CHUNK_SIDE - 1) / CHUNK_SIDE ||
+        h->chunks_z != (h->size_z + CHUNK_SIDE - 1) / CHUNK_SIDE || count == 0 ||
+        h->data_offset < sizeof(ChunkHeader) + sizeof(uint32_t) * count ||
+        h->data_offset % CHUNK_CELLS != 0 ||
+        file_len < h->data_offset + h->stored_chunks * CHUNK_CELLS) {
+        fprintf(stderr, "Bad chunked map '%s'\n", filename);
+        exit(1);
+    }
+
+    chunk_size_x = h->size_x; chunk_size_y = h->size_y; chunk_size_z = h->size_z;
+    chunk_count_x = h->chunks_x; chunk_count_y = h->chunks_y;
+    directory = (const uint32_t*)(file_map + sizeof(ChunkHeader));
+    pages = file_map + h->data_offset;
+    for (long c = 0; c < count; c++)
+        if (!CHUNK_IS_UNIFORM(directory[c]) && directory[c] >= h->stored_chunks) {
+            fprintf(stderr, "Bad chunked map '%s'\n", filename);
+            exit(1);
+        }
+
+    // chunk pages start on 4 KB boundaries: they can be dropped singly if a
+    // system page is no bigger than that
+    drop_pages = sysconf(_SC_PAGESIZE) <= CHUNK_CELLS;
+
+    slots = budget_bytes / CHUNK_CELLS;
+    if (slots < 1) slots = 1;
+    if (slots > count) slots = count;
+    pool = chunk_malloc((size_t)slots * CHUNK_CELLS);
+    slot_chunk = chunk_malloc(sizeof(long) * slots);
+    lru_prev = chunk_malloc(sizeof(int) * slots);
+    lru_next = chunk_malloc(sizeof(int) * slots);
+    chunk_slot = chunk_malloc(sizeof(int) * count);
+    memset(chunk_slot, 0xff, sizeof(int) * count);
+    slots_used = 0;
+    lru_head = lru_tail = -1;
+    chunk_last = -1;
+    chunk_hits = chunk_misses = chunk_uniform = 0;
+}
+
+void chunkmap_close(void) {
+    if (!file_map) return;
+    munmap(file_map, file_len);
+    free(pool);
+    free(slot_chunk);
+    free(lru_prev);
+    free(lru_next);
+    free(chunk_slot);
+    file_map = NULL;
+    pool = NULL;
+    slot_chunk = NULL;
+    lru_prev = lru_next = chunk_slot = NULL;
+    chunk_last = -1;
+    chunk_size_x = chunk_size_y = chunk_size_z = 0;
+}
+
+static void lru_unlink(int s) {
+    if (lru_prev[s] >= 0) lru_next[lru_prev[s]] = lru_next[s]; else lru_head = lru_next[s];
+    if (lru_next[s] >= 0) lru_prev[lru_next[s]] = lru_prev[s]; else lru_tail = lru_prev[s];
+}
+
+static void lru_push_front(int s) {
+    lru_prev[s] = -1;
+    lru_next[s] = lru_head;
+    if (lru_head >= 0) lru_prev[lru_head] = s; else lru_tail = s;
+    lru_head = s;
+}
+
+// copies chunk c (stored as page `page`) into a slot, evicting the least
+// recently used chunk when the cache is full
+static int page_in(long c, uint32_t page) {
+    int s;
+    if (slots_used < slots) {
+        s = slots_used++;
+    } else {
+        s = lru_tail;
+        lru_unlink(s);
+        chunk_slot[slot_chunk[s]] = -1;
+    }
+
+    const uint8_t* src = pages + (size_t)page * CHUNK_CELLS;
+    memcpy(pool + (size_t)s * CHUNK_CELLS, src, CHUNK_CELLS);
+    // the copy is all we keep: give the file page back rather than let the
+    // mapping grow to the whole map
+    if (drop_pages) madvise((void*)src, CHUNK_CELLS, MADV_DONTNEED);
+
+    slot_chunk[s] = c;
+    chunk_slot[c] = s;
+    lru_push_front(s);
+    return s;
+}
+
+uint8_t chunkmap_cell_slow(int x, int y, int z) {
+    if ((unsigned)x >= (unsigned)chunk_size_x || (unsigned)y >= (unsigned)chunk_size_y ||
+        (unsigned)z >= (unsigned)chunk_size_z)
+        return 1;   // off the map, like grid's border
+
+    long c = ((long)(z >> CHUNK_BITS) * chunk_count_y + (y >> CHUNK_BITS)) * chunk_count_x +
+             (x >> CHUNK_BITS);
+    uint32_t e = directory[c];
+    if (CHUNK_IS_UNIFORM(e)) {
+        chunk_uniform++;
+        return e & 0xff;
+    }
+
+    int s = chunk_slot[c];
+    if (s >= 0) {
+        chunk_hits++;
+        if (s != lru_head) {
+            lru_unlink(s);
+            lru_push_front(s);
+        }
+    } else {
+        chunk_misses++;
+        s = page_in(c, e);
+    }
+
+    chunk_last = c;
+    chunk_last_cells = pool + (size_t)s * CHUNK_CELLS;
+    int m = CHUNK_SIDE - 1;
+    return chunk_last_cells[((z & m) << (2 * CHUNK_BITS)) | ((y & m) << CHUNK_BITS) | (x & m)];
+}
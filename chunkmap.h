@@ -0,0 +1,82 @@
+//chunkmap.h
+// Paged voxel store for maps too big to keep resident. The map file holds
+// 16x16x16-cell chunks (one 4 KB page each) behind a directory; a chunk that
+// is all one value (open air, solid rubble) is stored in its directory entry
+// only. The file is memory-mapped, and the chunks being read are copied into
+// an LRU cache of CHUNK_CACHE_MB, and the page they came from is dropped
+// again, so resident memory stays within the budget whatever the map size.
+// Cells are addressed by coordinates; anything off the map reads as obstacle.
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+
+#include <stdint.h>
+#include "graph.h"
+
+#define CHUNK_BITS  4
+#define CHUNK_SIDE  (1 << CHUNK_BITS)
+#define CHUNK_CELLS (CHUNK_SIDE * CHUNK_SIDE * CHUNK_SIDE)   // x fastest, then y, z
+
+#define CHUNK_MAGIC   "RCHK"
+#define CHUNK_VERSION 1
+// directory entry of a chunk whose cells are all v; others hold a chunk number
+#define CHUNK_UNIFORM(v)       (0xffffff00u | (v))
+#define CHUNK_IS_UNIFORM(e)    ((e) >= 0xffffff00u)
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t size_x, size_y, size_z;
+    uint32_t chunks_x, chunks_y, chunks_z;
+    uint64_t stored_chunks;   // chunks with their own page
+    uint64_t data_offset;     // first chunk page, page aligned
+    uint32_t reserved[4];
+} ChunkHeader;
+
+extern int CHUNK_CACHE_MB;   // config: memory for cached chunks
+
+// cell lookups since chunkmap_open(), by where the cell was found
+extern long chunk_hits;      // chunk already cached
+extern long chunk_misses;    // chunk paged in (evicting the least recently used)
+extern long chunk_uniform;   // chunk stored implicitly, nothing to page
+
+extern int chunk_size_x, chunk_size_y, chunk_size_z;   // map size in cells
+
+// (dx, dy, dz) of each Move
+static const int chunk_move_step[6][3] = {
+    { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+};
+
+// linear index of a cell, 64-bit: a paged map may have more cells than an int counts
+static inline uint64_t chunkmap_index(int x, int y, int z) {
+    return ((uint64_t)z * chunk_size_y + y) * chunk_size_x + x;
+}
+
+// writes the loaded (dense) map in chunked form
+void chunkmap_save(const char* filename);
+
+void chunkmap_open(const char* filename, long budget_bytes);
+void chunkmap_close(void);
+
+// lookup state for the inline fast path below
+extern int chunk_count_x, chunk_count_y;      // chunks per row / per layer row
+extern long chunk_last;                       // cached chunk of the last lookup, -1 none
+extern const uint8_t* chunk_last_cells;
+uint8_t chunkmap_cell_slow(int x, int y, int z);
+
+// the cell at (x, y, z): 0 free 1 obstacle 2 survivor 3 risk, as in grid;
+// not thread safe (the cache is shared state)
+static inline uint8_t chunkmap_cell(int x, int y, int z) {
+    if ((unsigned)x < (unsigned)chunk_size_x && (unsigned)y < (unsigned)chunk_size_y &&
+        (unsigned)z < (unsigned)chunk_size_z) {
+        long c = ((long)(z >> CHUNK_BITS) * chunk_count_y + (y >> CHUNK_BITS)) * chunk_count_x +
+                 (x >> CHUNK_BITS);
+        if (c == chunk_last) {
+            chunk_hits++;
+            int m = CHUNK_SIDE - 1;
+            return chunk_last_cells[((z & m) << (2 * CHUNK_BITS)) | ((y & m) << CHUNK_BITS) | (x & m)];
+        }
+    }
+    return chunkmap_cell_slow(x, y, z);
+}
+
+#endif
@@ -0,0 +1,201 @@
+//distfield.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "distfield.h"
+
+int32_t* survivor_dist = NULL;
+int* survivor_cells = NULL;
+int survivor_count = 0;
+
+long distfield_dense_levels = 0;
+long distfield_sparse_levels = 0;
+
+// scratch shared by every BFS on the current map
+static long words = 0;
+static uint64_t* open_bits = NULL;   // 1 = cell a robot can stand in
+static uint64_t* visited = NULL;
+static uint64_t* frontier = NULL;
+static int* list = NULL;             // current level's cells, then the next one's
+static int* next_list = NULL;
+
+typedef struct {
+    int source;
+    long last_use;
+    int32_t* dist;
+} CachedField;
+
+static CachedField cache[DIST_FIELD_CACHE];
+static long cache_clock = 0;
+
+static void* dist_malloc(size_t size) {
+    void* p = malloc(size);
+    if (!p) { perror("malloc"); exit(1); }
+    return p;
+}
+
+static inline int bit_test(const uint64_t* b, int i) {
+    return (b[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bit_set(uint64_t* b, int i) {
+    b[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+// the 64 bits of b starting at bit position `bit` (may be unaligned or
+// outside the array, which reads as zeros)
+static inline uint64_t bits_at(const uint64_t* b, long bit) {
+    long w = bit >> 6;
+    int r = (int)(bit & 63);
+    uint64_t lo = (w >= 0 && w < words) ? b[w] : 0;
+    if (r == 0) return lo;
+    uint64_t hi = (w + 1 >= 0 && w + 1 < words) ? b[w + 1] : 0;
+    return (lo >> r) | (hi << (64 - r));
+}
+
+void distfield_bfs(const int* sources, int count, int32_t* dist) {
+    memset(dist, 0xff, sizeof(int32_t) * grid_cells);   // DIST_UNREACHABLE
+    memset(visited, 0, sizeof(uint64_t) * words);
+
+    int n = 0, lo = grid_cells, hi = -1;
+    for (int i = 0; i < count; i++) {
+        int c = sources[i];
+        if (!bit_test(open_bits, c) || bit_test(visited, c)) continue;
+        bit_set(visited, c);
+        dist[c] = 0;
+        list[n++] = c;
+        if (c < lo) lo = c;
+        if (c > hi) hi = c;
+    }
+
+    for (int level = 1; n > 0; level++) {
+        int m = 0, next_lo = grid_cells, next_hi = -1;
+
+        // every new cell lies within one level stride of the frontier
+        long first = (lo - stride_z) >> 6, last = (hi + stride_z) >> 6;
+        if (first < 0) first = 0;
+        if (last >= words) last = words - 1;
+
+        if (n >= last - first + 1) {
+            // wide frontier: dilate it a word at a time
+            for (int i = 0; i < n; i++) bit_set(frontier, list[i]);
+
+            for (long w = first; w <= last; w++) {
+                long bit = w << 6;
+                uint64_t near = bits_at(frontier, bit + 1) | bits_at(frontier, bit - 1) |
+                                bits_at(frontier, bit + stride_y) | bits_at(frontier, bit - stride_y) |
+                                bits_at(frontier, bit + stride_z) | bits_at(frontier, bit - stride_z);
+                uint64_t fresh = near & open_bits[w] & ~visited[w];
+                if (!fresh) continue;
+
+                visited[w] |= fresh;
+                while (fresh) {
+                    int c = (int)(bit + __builtin_ctzll(fresh));
+                    fresh &= fresh - 1;
+                    dist[c] = level;
+                    next_list[m++] = c;
+                }
+                if ((int)bit < next_lo) next_lo = (int)bit;
+                next_hi = (int)bit + 63;
+            }
+
+            for (int i = 0; i < n; i++) frontier[list[i] >> 6] = 0;
+            distfield_dense_levels++;
+        } else {
+            // narrow frontier: visit each cell's neighbours
+            for (int i = 0; i < n; i++) {
+                for (int d = 0; d < 6; d++) {
+                    int c = list[i] + move_delta[d];
+                    if (!bit_test(open_bits, c) || bit_test(visited, c)) continue;
+                    bit_set(visited, c);
+                    dist[c] = level;
+                    next_list[m++] = c;
+                    if (c < next_lo) next_lo = c;
+                    if (c > next_hi) next_hi = c;
+                }
+            }
+            distfield_sparse_levels++;
+        }
+
+        int* t = list;
+        list = next_list;
+        next_list = t;
+        n = m;
+        lo = next_lo;
+        hi = next_hi;
+    }
+}
+
+void distfield_release(void) {
+    free(survivor_dist);
+    free(survivor_cells);
+    free(open_bits);
+    free(visited);
+    free(frontier);
+    free(list);
+    free(next_list);
+    survivor_dist = NULL;
+    survivor_cells = NULL;
+    open_bits = visited = frontier = NULL;
+    list = next_list = NULL;
+    survivor_count = 0;
+    words = 0;
+
+    for (int i = 0; i < DIST_FIELD_CACHE; i++) {
+        free(cache[i].dist);
+        cache[i].dist = NULL;
+    }
+}
+
+void distfield_build(const int32_t* survivors, int count) {
+    distfield_release();
+
+    words = (grid_cells + 63) / 64;
+    open_bits = calloc(words, sizeof(uint64_t));
+    visited = dist_malloc(sizeof(uint64_t) * words);
+    frontier = calloc(words, sizeof(uint64_t));
+    if (!open_bits || !frontier) { perror("calloc"); exit(1); }
+    list = dist_malloc(sizeof(int) * grid_cells);
+    next_list = dist_malloc(sizeof(int) * grid_cells);
+    survivor_dist = dist_malloc(sizeof(int32_t) * grid_cells);
+
+    if (survivors) {
+        for (int i = 0; i < grid_cells; i++)
+            if (map_cell(i) != 1) bit_set(open_bits, i);
+        survivor_cells = dist_malloc(sizeof(int) * (count + 1));
+        memcpy(survivor_cells, survivors, sizeof(int) * count);
+        survivor_count = count;
+    } else {
+        survivor_count = 0;
+        for (int i = 0; i < grid_cells; i++) {
+            if (map_cell(i) == 1) continue;
+            bit_set(open_bits, i);
+            if (map_cell(i) == 2) survivor_count++;
+        }
+
+        survivor_cells = dist_malloc(sizeof(int) * (survivor_count + 1));
+        survivor_count = 0;
+        for (int i = 0; i < grid_cells; i++)
+            if (map_cell(i) == 2) survivor_cells[survivor_count++] = i;
+    }
+
+    distfield_bfs(survivor_cells, survivor_count, survivor_dist);
+}
+
+const int32_t* distfield_from(int cell) {
+    CachedField* slot = &cache[0];
+    for (int i = 0; i < DIST_FIELD_CACHE; i++) {
+        if (cache[i].dist && cache[i].source == cell) {
+            cache[i].last_use = ++cache_clock;
+            return cache[i].dist;
+        }
+        if (!cache[i].dist || (slot->dist && cache[i].last_use < slot->last_use))
+            slot = &cache[i];
+    }
+
+    if (!slot->dist) slot->dist = dist_malloc(sizeof(int32_t) * grid_cells);
+    slot->source = cell;
+    slot->last_use = ++cache_clock;
+    distfield_bfs(&cell, 1, slot->dist);
+    return slot->dist;
+}
@@ -0,0 +1,40 @@
+//distfield.h
+// Breadth-first distance fields over the padded grid: moves from every cell
+// to the nearest survivor (built once when a map is loaded) and, on demand,
+// to one given cell (a few kept in an LRU cache). Levels with a wide frontier
+// are expanded 64 cells per word over a packed occupancy bitset; narrow ones
+// walk a plain cell list.
+#ifndef DISTFIELD_H
+#define DISTFIELD_H
+
+#include <stdint.h>
+#include "graph.h"
+
+#define DIST_UNREACHABLE  -1
+#define DIST_FIELD_CACHE  4   // single-source fields kept between calls
+
+extern int32_t* survivor_dist;   // per padded cell, DIST_UNREACHABLE if cut off
+extern int* survivor_cells;      // padded index of every survivor
+extern int survivor_count;
+
+// level counts over all fields built so far, by how they were expanded
+extern long distfield_dense_levels, distfield_sparse_levels;
+
+// called by load_3d_map; survivors (padded indices) if the map file lists
+// them, else NULL and the grid is scanned for them
+void distfield_build(const int32_t* survivors, int count);
+void distfield_release(void);   // called by free_3d_map
+
+// moves from every cell to `cell` (the grid is undirected, so also the
+// other way round); the field stays valid until DIST_FIELD_CACHE other
+// sources have been asked for or the map changes
+const int32_t* distfield_from(int cell);
+
+// multi-source BFS into dist (grid_cells entries)
+void distfield_bfs(const int* sources, int count, int32_t* dist);
+
+static inline int distance_to_survivor(int cell) {
+    return survivor_dist[cell];
+}
+
+#endif
@@ -0,0 +1,131 @@
+//explore.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "explore.h"
+
+uint64_t* explored_by_others = NULL;
+long explore_words = 0;
+__thread int explore_member = -1;
+
+// The publishing process's own bookkeeping, next to the shared bits: each
+// member's bits and distinct cells, and how many members' paths enter each
+// cell. A publish only touches the cells that differ between the two paths.
+static uint64_t* mine = NULL;         // member k's own word w at [w * TEAM_SIZE + k]
+static uint64_t* fresh = NULL;        // scratch: cells of the path being published
+static uint8_t* refs = NULL;          // per cell: members whose path enters it
+static int* cells[TEAM_SIZE + 1];     // each member's cells in walk order, plus a spare list
+static int cell_count[TEAM_SIZE];
+static long covered = 0;              // cells with refs > 0
+
+static long words_for_grid(void) {
+    return (grid_cells + 63) / 64;
+}
+
+size_t explore_bytes(void) {
+    return sizeof(uint64_t) * words_for_grid() * TEAM_SIZE;
+}
+
+void explore_attach(void* mem) {
+    explore_words = words_for_grid();
+    explored_by_others = mem;
+
+    mine = calloc((size_t)explore_words * TEAM_SIZE, sizeof(uint64_t));
+    fresh = calloc(explore_words, sizeof(uint64_t));
+    refs = calloc(grid_cells, 1);
+    if (!mine || !fresh || !refs) { perror("calloc"); exit(1); }
+    for (int k = 0; k <= TEAM_SIZE; k++) {
+        cells[k] = malloc(sizeof(int) * MAX_PATH_LENGTH);
+        if (!cells[k]) { perror("malloc"); exit(1); }
+    }
+    memset(cell_count, 0, sizeof(cell_count));
+    covered = 0;
+}
+
+void explore_detach(void) {
+    free(mine);
+    free(fresh);
+    free(refs);
+    for (int k = 0; k <= TEAM_SIZE; k++) {
+        free(cells[k]);
+        cells[k] = NULL;
+    }
+    mine = fresh = NULL;
+    refs = NULL;
+    explored_by_others = NULL;
+    explore_words = 0;
+}
+
+// pos changed hands: recompute every member's view of it
+static void update_others(int pos) {
+    size_t w = (size_t)(pos >> 6) * TEAM_SIZE;
+    uint64_t bit = (uint64_t)1 << (pos & 63);
+    for (int k = 0; k < TEAM_SIZE; k++) {
+        int others = refs[pos] - !!(mine[w + k] & bit);
+        if (others > 0) explored_by_others[w + k] |= bit;
+        else explored_by_others[w + k] &= ~bit;
+    }
+}
+
+// Walks c the way simulate_path() does, up to an obstacle or the survivor.
+// Only between batches: robots read these bits without synchronizing.
+void explore_publish(int member, const Chromosome* c) {
+    if (!explored_by_others) return;
+
+    uint64_t* own = mine + member;
+    int* next = cells[TEAM_SIZE];
+    int n = 0;
+
+    // cells the new path enters; the ones the old path missed join
+    int pos = point_to_index(c->start);
+    for (int i = 0; i < c->length; i++) {
+        pos += move_delta[get_move(c, i)];
+        int cell = map_cell(pos);
+        if (cell == 1) break;
+
+        size_t w = (size_t)(pos >> 6);
+        uint64_t bit = (uint64_t)1 << (pos & 63);
+        if (!(fresh[w] & bit)) {
+            fresh[w] |= bit;
+            next[n++] = pos;
+            if (!(own[w * TEAM_SIZE] & bit)) {
+                own[w * TEAM_SIZE] |= bit;
+                if (refs[pos]++ == 0) covered++;
+                update_others(pos);
+            }
+        }
+        if (cell == 2) break;
+    }
+
+    // the old path's cells the new one does not enter leave
+    const int* old = cells[member];
+    for (int j = 0; j < cell_count[member]; j++) {
+        int p = old[j];
+        size_t w = (size_t)(p >> 6);
+        uint64_t bit = (uint64_t)1 << (p & 63);
+        if (fresh[w] & bit) continue;
+        own[w * TEAM_SIZE] &= ~bit;
+        if (--refs[p] == 0) covered--;
+        update_others(p);
+    }
+
+    for (int j = 0; j < n; j++) fresh[next[j] >> 6] = 0;
+    cells[TEAM_SIZE] = cells[member];
+    cells[member] = next;
+    cell_count[member] = n;
+}
+
+long explore_count(void) {
+    return explored_by_others ? covered : 0;
+}
+
+long explore_count_member(int member) {
+    if (!explored_by_others || member < 0 || member >= TEAM_SIZE) return 0;
+    return cell_count[member];
+}
+
+long explore_count_members(void) {
+    long n = 0;
+    for (int k = 0; k < TEAM_SIZE; k++) n += explore_count_member(k);
+    return n;
+}
@@ -0,0 +1,38 @@
+//explore.h
+// Team exploration state. For each team member, one bit per padded cell set
+// on the cells the other members' current best paths enter: the member's view
+// of what its team already covers. The members' words for the same 64 cells
+// are side by side, one cache line for the whole team (TEAM_SIZE 8), and a
+// novelty test reads one word. The bits live in the robots' shared memory
+// segment. The parent updates them between batches, whenever a member gets a
+// new best (explore_publish), and robots only read them, so a path's novelty
+// does not depend on which paths were scored before it.
+#ifndef EXPLORE_H
+#define EXPLORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "multi.h"     // TEAM_SIZE, Chromosome, W_NOVELTY
+
+extern uint64_t* explored_by_others;   // member k's word w at [w * TEAM_SIZE + k]; NULL until explore_attach()
+extern long explore_words;
+extern __thread int explore_member;   // member simulate_path() scores novelty for, -1 = none
+
+size_t explore_bytes(void);               // shared memory the bitsets need
+void explore_attach(void* mem);           // mem: explore_bytes(), zeroed
+void explore_detach(void);
+void explore_publish(int member, const Chromosome* c);   // c becomes member's path
+
+// 1 if cell is on no other member's path: new coverage for member's team.
+// Walks scored for no member (member < 0) find nothing new.
+static inline int explore_novel(int cell, int member) {
+    if (member < 0 || !explored_by_others) return 0;
+    uint64_t others = explored_by_others[(size_t)(cell >> 6) * TEAM_SIZE + member];
+    return !(others >> (cell & 63) & 1);
+}
+
+long explore_count(void);                // cells on some member's path
+long explore_count_member(int member);   // cells on member's path
+long explore_count_members(void);        // the above summed over the team (>= explore_count)
+
+#endif
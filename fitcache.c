@@ -0,0 +1,61 @@
+//fitcache.c
+#include <string.h>
+#include "fitcache.h"
+
+#define FITNESS_CACHE_SIZE (1 << FITNESS_CACHE_BITS)
+
+typedef struct {
+    uint64_t hash;   // 0 = empty
+    int length;
+    double fitness;
+} CacheEntry;
+
+static CacheEntry cache[FITNESS_CACHE_SIZE];
+
+long fitness_cache_hits = 0;
+long fitness_cache_misses = 0;
+
+// splitmix64 finalizer
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Genes are packed with zeroed tail bits, so hashing whole words is exact
+uint64_t chromosome_hash(const Chromosome* c) {
+    uint64_t h = mix64(((uint64_t)(uint32_t)c->start.x << 32) ^ (uint32_t)c->start.y);
+    h = mix64(h ^ ((uint64_t)(uint32_t)c->start.z << 32) ^ (uint32_t)c->length);
+
+    int words = GENE_WORDS(c->length);
+    for (int i = 0; i < words; i++)
+        h = mix64(h ^ c->genes[i]) + i;
+
+    return h ? h : 1;   // 0 marks an empty slot
+}
+
+int fitness_cache_lookup(uint64_t hash, int length, double* fitness) {
+    CacheEntry* e = &cache[hash & (FITNESS_CACHE_SIZE - 1)];
+    if (e->hash == hash && e->length == length) {
+        *fitness = e->fitness;
+        fitness_cache_hits++;
+        return 1;
+    }
+    fitness_cache_misses++;
+    return 0;
+}
+
+// direct-mapped: a newer path simply replaces whatever shared its slot
+void fitness_cache_store(uint64_t hash, int length, double fitness) {
+    CacheEntry* e = &cache[hash & (FITNESS_CACHE_SIZE - 1)];
+    e->hash = hash;
+    e->length = length;
+    e->fitness = fitness;
+}
+
+void fitness_cache_clear(void) {
+    memset(cache, 0, sizeof(cache));
+    fitness_cache_hits = 0;
+    fitness_cache_misses = 0;
+}
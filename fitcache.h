@@ -0,0 +1,20 @@
+//fitcache.h
+// Fixed-size fitness memo keyed by a 64-bit hash of (start, length, genes),
+// checked before a chromosome is sent to a robot.
+#ifndef FITCACHE_H
+#define FITCACHE_H
+
+#include <stdint.h>
+#include "genetic.h"
+
+#define FITNESS_CACHE_BITS 16   // 65536 entries
+
+extern long fitness_cache_hits;
+extern long fitness_cache_misses;
+
+uint64_t chromosome_hash(const Chromosome* c);
+int  fitness_cache_lookup(uint64_t hash, int length, double* fitness);   // 1 on hit
+void fitness_cache_store(uint64_t hash, int length, double fitness);
+void fitness_cache_clear(void);
+
+#endif
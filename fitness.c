@@ -0,0 +1,496 @@
+//fitness.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fitness.h"
+#include "explore.h"
+#include "chunkmap.h"
+#include "spacetime.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+// Scratch is per thread: the threads backend walks paths concurrently.
+// visited[cell] == stamp means "seen in this walk": no clearing per walk
+static __thread unsigned int* visited = NULL;
+static __thread int visited_cells = 0;   // grid_cells it was sized for
+static __thread unsigned int stamp = 0;
+
+// one place for the W_* formula, so every kernel scores bit-identically;
+// novel: cells on no other team member's path
+static inline double path_fitness(int survivors, int coverage, int steps, int risk, int novel) {
+    return W_SURVIVORS * survivors +
+           W_COVERAGE * coverage -
+           W_LENGTH * steps -
+           W_RISK * risk +
+           W_NOVELTY * novel;
+}
+
+double simulate_path(const uint64_t* genes, int length, Point start,
+                     EvalCheckpoint* checkpoints, int* cells, int resume_count,
+                     int* checkpoint_count, int* simulated) {
+    int stride = checkpoint_stride(length);
+    int survivors = 0, coverage = 0, risk = 0, steps = 0, novel = 0;
+    int n_cp = 0, i = 0;
+    int member = explore_member;
+
+    *checkpoint_count = 0;
+    *simulated = 0;
+
+    // only the start needs a bounds check, every later step is caught by the border
+    if (!is_free_cell(start.x, start.y, start.z)) return INVALID_FITNESS;
+
+    if (visited_cells != grid_cells) {   // first walk, or another map since
+        free(visited);
+        visited = calloc(grid_cells, sizeof(unsigned int));
+        if (!visited) { perror("calloc"); exit(1); }
+        visited_cells = grid_cells;
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        memset(visited, 0, grid_cells * sizeof(unsigned int));
+        stamp = 1;
+    }
+
+    int pos = point_to_index(start);
+    uint64_t word = 0;
+
+    if (checkpoints && resume_count > 0) {
+        const EvalCheckpoint* cp = &checkpoints[resume_count - 1];
+
+        // the prefix is known valid and survivor-free: mark the cells it
+        // entered, each once, and only count the novel ones again
+        for (int j = 0; j < cp->coverage; j++) visited[cells[j]] = stamp;
+        if (member >= 0)
+            for (int j = 0; j < cp->coverage; j++) novel += explore_novel(cells[j], member);
+
+        i = cp->gene;
+        pos = cp->pos;
+        coverage = cp->coverage;
+        risk = cp->risk;
+        steps = cp->gene;
+        n_cp = resume_count;
+    }
+    int next_cp = i + stride;
+
+    for (; i < length; i++) {
+        // unpack: load a word every 21 moves, then shift 3 bits per move
+        if (i % GENES_PER_WORD == 0) word = genes[i / GENES_PER_WORD];
+        pos += move_delta[word & 7];
+        word >>= GENE_BITS;
+        (*simulated)++;
+
+        // the border is obstacle too, so this also catches leaving the map
+        int cell = map_cell(pos);
+        if (cell == 1) {
+            *checkpoint_count = n_cp;
+            return INVALID_FITNESS;
+        }
+
+        // a cell this walk already entered is marked already
+        if (visited[pos] != stamp) {
+            visited[pos] = stamp;
+            if (checkpoints) cells[coverage] = pos;
+            coverage++;
+            novel += explore_novel(pos, member);
+        }
+
+        if (cell == 2) {
+            survivors++;
+            break;
+        }
+        if (cell == 3) risk++;
+
+        steps++;
+
+        if (i + 1 == next_cp && n_cp < MAX_CHECKPOINTS && checkpoints) {
+            next_cp += stride;
+            EvalCheckpoint* cp = &checkpoints[n_cp++];
+            cp->gene = i + 1;
+            cp->pos = pos;
+            cp->coverage = coverage;
+            cp->risk = risk;
+        }
+    }
+
+    *checkpoint_count = n_cp;
+    return path_fitness(survivors, coverage, steps, risk, novel);
+}
+
+// Same walk and score as simulate_path() (no checkpoints), over the paged
+// store: cells come from chunkmap_cell() and the cells already entered are
+// kept in a hash set, so memory follows the path, not the map.
+double simulate_path_paged(const uint64_t* genes, int length, Point start) {
+    static SpaceTimeTable seen;
+    int survivors = 0, coverage = 0, risk = 0, steps = 0;
+
+    if (chunkmap_cell(start.x, start.y, start.z) == 1) return INVALID_FITNESS;
+
+    if (!seen.entries) st_init(&seen, length);
+    else st_clear(&seen);
+
+    int x = start.x, y = start.y, z = start.z;
+    uint64_t word = 0;
+    for (int i = 0; i < length; i++) {
+        if (i % GENES_PER_WORD == 0) word = genes[i / GENES_PER_WORD];
+        const int* step = chunk_move_step[word & 7];
+        word >>= GENE_BITS;
+        x += step[0]; y += step[1]; z += step[2];
+
+        int cell = chunkmap_cell(x, y, z);   // off the map reads as obstacle
+        if (cell == 1) return INVALID_FITNESS;
+
+        SpaceTimeEntry* e = st_insert(&seen, chunkmap_index(x, y, z));
+        if (!e->a) {
+            e->a = 1;
+            coverage++;
+        }
+
+        if (cell == 2) {
+            survivors++;
+            break;
+        }
+        if (cell == 3) risk++;
+        steps++;
+    }
+    return path_fitness(survivors, coverage, steps, risk, 0);
+}
+
+// ---------- lock-step kernel: FITNESS_LANES paths per AVX2 register ----------
+
+static void simulate_paths_scalar(PathJob* jobs, int count) {
+    for (int j = 0; j < count; j++) {
+        explore_member = jobs[j].member;
+        jobs[j].fitness = simulate_path(jobs[j].genes, jobs[j].length, jobs[j].start,
+                                        jobs[j].checkpoints, jobs[j].cells, jobs[j].resume_count,
+                                        &jobs[j].checkpoint_count, &jobs[j].simulated);
+    }
+    explore_member = -1;
+}
+
+#ifdef HAVE_X86_SIMD
+
+// Lane state, spilled to memory only when a lane finishes or reloads a word.
+typedef struct {
+    int pos[FITNESS_LANES], gene[FITNESS_LANES], len[FITNESS_LANES];
+    int cov[FITNESS_LANES], risk[FITNESS_LANES], surv[FITNESS_LANES];
+    int novel[FITNESS_LANES];     // cells on no other member's path (never in a register)
+    int member[FITNESS_LANES];    // member the lane's novelty counts for
+    int left[FITNESS_LANES];      // genes left in the lane's current word
+    int word[FITNESS_LANES];      // index of the lane's next word
+    int cp_left[FITNESS_LANES];   // genes until the lane's next checkpoint
+    int stride[FITNESS_LANES];    // checkpoint_stride() of the lane's path
+    int stamp[FITNESS_LANES];     // lane's visited stamp for its current path
+    int busy[FITNESS_LANES];      // -1 while the lane holds a path
+    int job[FITNESS_LANES];
+    int n_cp[FITNESS_LANES];
+    int* cells[FITNESS_LANES];    // the job's cells when it lays checkpoints, else NULL
+    int n_cells[FITNESS_LANES];   // cells entered so far (the lane's coverage)
+    unsigned record_lanes;        // lanes with cells
+    unsigned novel_lanes;         // lanes scored for a team member
+    long long genes[FITNESS_LANES];   // genome address, for the 64-bit word gathers
+} LaneState;
+
+static __thread unsigned int* lane_visited = NULL;   // FITNESS_LANES stamp arrays
+static __thread int lane_visited_cells = 0;
+static __thread unsigned int lane_stamp[FITNESS_LANES];
+
+// Put the next path into lane l: start check, resume from the last
+// checkpoint. Paths that finish without a step are scored here. 0 when none left.
+static int lane_load(LaneState* st, int l, PathJob* jobs, int count, int* next) {
+    while (*next < count) {
+        int j = (*next)++;
+        PathJob* job = &jobs[j];
+
+        job->fitness = INVALID_FITNESS;
+        job->checkpoint_count = 0;
+        job->simulated = 0;
+        if (!is_free_cell(job->start.x, job->start.y, job->start.z)) continue;
+
+        unsigned int* visited = lane_visited + (size_t)l * grid_cells;
+        if (++lane_stamp[l] == 0) {
+            memset(visited, 0, grid_cells * sizeof(unsigned int));
+            lane_stamp[l] = 1;
+        }
+        unsigned int stamp = lane_stamp[l];
+
+        int pos = point_to_index(job->start);
+        int gene = 0, cov = 0, risk = 0, n_cp = 0, novel = 0;
+
+        if (job->checkpoints && job->resume_count > 0) {
+            const EvalCheckpoint* cp = &job->checkpoints[job->resume_count - 1];
+            for (int k = 0; k < cp->coverage; k++) visited[job->cells[k]] = stamp;
+            if (job->member >= 0)
+                for (int k = 0; k < cp->coverage; k++) novel += explore_novel(job->cells[k], job->member);
+            pos = cp->pos;
+            gene = cp->gene;
+            cov = cp->coverage;
+            risk = cp->risk;
+            n_cp = job->resume_count;
+        }
+
+        if (gene >= job->length) {
+            job->checkpoint_count = n_cp;
+            job->fitness = path_fitness(0, cov, gene, risk, novel);
+            continue;
+        }
+
+        // gene is 0 or a checkpoint, so it sits on a word and a stride boundary
+        st->pos[l] = pos;
+        st->gene[l] = gene;
+        st->len[l] = job->length;
+        st->cov[l] = cov;
+        st->risk[l] = risk;
+        st->surv[l] = 0;
+        st->novel[l] = novel;
+        st->member[l] = job->member;
+        st->left[l] = 0;
+        st->word[l] = gene / GENES_PER_WORD;
+        st->genes[l] = (long long)(intptr_t)job->genes;
+        st->stride[l] = checkpoint_stride(job->length);
+        st->cp_left[l] = st->stride[l];
+        st->stamp[l] = (int)stamp;
+        st->busy[l] = -1;
+        st->job[l] = j;
+        st->n_cp[l] = n_cp;
+        st->cells[l] = job->checkpoints ? job->cells : NULL;
+        st->n_cells[l] = cov;
+        st->record_lanes = (st->record_lanes & ~(1u << l)) | (unsigned)(st->cells[l] != NULL) << l;
+        st->novel_lanes = (st->novel_lanes & ~(1u << l)) | (unsigned)(job->member >= 0) << l;
+        return 1;
+    }
+    st->busy[l] = 0;
+    st->record_lanes &= ~(1u << l);
+    st->novel_lanes &= ~(1u << l);
+    return 0;
+}
+
+// Walks FITNESS_LANES paths in lock-step, positions held as linear cell
+// indices. Each step decodes one gene per lane, gathers the cells from the
+// grid and the lanes' visited stamps, and updates the counters under the
+// active mask. A lane that hits an obstacle, a survivor or the end of its
+// path is scored and refilled with the next job straight away, so short
+// paths do not leave lanes idle.
+__attribute__((target("avx2")))
+static void simulate_lanes_avx2(PathJob* jobs, int count) {
+    if (lane_visited_cells != grid_cells) {
+        free(lane_visited);
+        lane_visited = calloc((size_t)grid_cells * FITNESS_LANES, sizeof(unsigned int));
+        if (!lane_visited) { perror("calloc"); exit(1); }
+        lane_visited_cells = grid_cells;
+        memset(lane_stamp, 0, sizeof(lane_stamp));
+    }
+
+    int next = 0;
+    LaneState st;
+    memset(&st, 0, sizeof(st));
+    for (int l = 0; l < FITNESS_LANES; l++) lane_load(&st, l, jobs, count, &next);
+
+    const __m256i seven64 = _mm256_set1_epi64x(7);
+    const __m256i low_dwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i obstacle = _mm256_set1_epi32(1);
+    const __m256i survivor = _mm256_set1_epi32(2);
+    const __m256i hazard = _mm256_set1_epi32(3);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i deltas = _mm256_setr_epi32(move_delta[0], move_delta[1], move_delta[2],
+                                             move_delta[3], move_delta[4], move_delta[5], 0, 0);
+    const __m256i lane_base = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                 _mm256_set1_epi32(grid_cells));
+
+#define LOAD_LANES() do { \
+        vpos = _mm256_loadu_si256((const __m256i*)st.pos); \
+        vgene = _mm256_loadu_si256((const __m256i*)st.gene); \
+        vlen = _mm256_loadu_si256((const __m256i*)st.len); \
+        vcov = _mm256_loadu_si256((const __m256i*)st.cov); \
+        vrisk = _mm256_loadu_si256((const __m256i*)st.risk); \
+        vsurv = _mm256_loadu_si256((const __m256i*)st.surv); \
+        vleft = _mm256_loadu_si256((const __m256i*)st.left); \
+        vcp_left = _mm256_loadu_si256((const __m256i*)st.cp_left); \
+        vstride = _mm256_loadu_si256((const __m256i*)st.stride); \
+        vstamp = _mm256_loadu_si256((const __m256i*)st.stamp); \
+        vbusy = _mm256_loadu_si256((const __m256i*)st.busy); \
+        vword = _mm256_loadu_si256((const __m256i*)st.word); \
+        vgenes_lo = _mm256_loadu_si256((const __m256i*)&st.genes[0]); \
+        vgenes_hi = _mm256_loadu_si256((const __m256i*)&st.genes[4]); \
+    } while (0)
+#define STORE_LANES() do { \
+        _mm256_storeu_si256((__m256i*)st.pos, vpos); \
+        _mm256_storeu_si256((__m256i*)st.gene, vgene); \
+        _mm256_storeu_si256((__m256i*)st.cov, vcov); \
+        _mm256_storeu_si256((__m256i*)st.risk, vrisk); \
+        _mm256_storeu_si256((__m256i*)st.surv, vsurv); \
+        _mm256_storeu_si256((__m256i*)st.left, vleft); \
+        _mm256_storeu_si256((__m256i*)st.cp_left, vcp_left); \
+        _mm256_storeu_si256((__m256i*)st.word, vword); \
+    } while (0)
+
+    __m256i vpos, vgene, vlen, vcov, vrisk, vsurv, vleft, vcp_left, vstride, vstamp, vbusy;
+    __m256i vword, vgenes_lo, vgenes_hi;
+    __m256i wlo = zero, whi = zero;
+    LOAD_LANES();
+
+    int slot_out[FITNESS_LANES], pos_out[FITNESS_LANES];
+
+    while (_mm256_movemask_ps(_mm256_castsi256_ps(vbusy))) {
+        __m256i active = vbusy;
+
+        // lanes that used up their word gather the next one (absolute
+        // addresses); a gather costs as much masked off, so most steps skip it
+        __m256i reload = _mm256_and_si256(active, _mm256_cmpeq_epi32(vleft, zero));
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(reload))) {
+            __m256i addr_lo = _mm256_add_epi64(vgenes_lo,
+                                  _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(vword)), 3));
+            __m256i addr_hi = _mm256_add_epi64(vgenes_hi,
+                                  _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(vword, 1)), 3));
+            wlo = _mm256_mask_i64gather_epi64(wlo, (const long long*)0, addr_lo,
+                                              _mm256_cvtepi32_epi64(_mm256_castsi256_si128(reload)), 1);
+            whi = _mm256_mask_i64gather_epi64(whi, (const long long*)0, addr_hi,
+                                              _mm256_cvtepi32_epi64(_mm256_extracti128_si256(reload, 1)), 1);
+            vword = _mm256_sub_epi32(vword, reload);
+            vleft = _mm256_blendv_epi8(vleft, _mm256_set1_epi32(GENES_PER_WORD), reload);
+        }
+
+        // decode one 3-bit move per lane and turn it into an index delta
+        __m128i mlo = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_and_si256(wlo, seven64), low_dwords));
+        __m128i mhi = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_and_si256(whi, seven64), low_dwords));
+        __m256i move = _mm256_inserti128_si256(_mm256_castsi128_si256(mlo), mhi, 1);
+        wlo = _mm256_srli_epi64(wlo, GENE_BITS);
+        whi = _mm256_srli_epi64(whi, GENE_BITS);
+
+        // busy lanes are -1: subtracting the mask counts one step for each
+        vpos = _mm256_add_epi32(vpos, _mm256_and_si256(_mm256_permutevar8x32_epi32(deltas, move), active));
+        vgene = _mm256_sub_epi32(vgene, active);
+        vleft = _mm256_add_epi32(vleft, active);
+        vcp_left = _mm256_add_epi32(vcp_left, active);
+
+        // the grid has GRID_SLACK spare bytes, so a 4-byte load at any cell is safe
+        __m256i cell = _mm256_mask_i32gather_epi32(zero, (const int*)grid, vpos, active, 1);
+        cell = _mm256_and_si256(cell, byte_mask);
+
+        __m256i invalid = _mm256_and_si256(active, _mm256_cmpeq_epi32(cell, obstacle));
+        __m256i ok = _mm256_andnot_si256(invalid, active);
+
+        // coverage: gather each lane's stamp for its cell, count first visits
+        __m256i slot = _mm256_add_epi32(lane_base, vpos);
+        __m256i seen = _mm256_mask_i32gather_epi32(zero, (const int*)lane_visited, slot, ok, 4);
+        __m256i fresh = _mm256_andnot_si256(_mm256_cmpeq_epi32(seen, vstamp), ok);
+        vcov = _mm256_sub_epi32(vcov, fresh);
+
+        // AVX2 has no scatter: store stamps lane by lane, and only on a first
+        // visit (any other lane that moved has its stamp there already). Such
+        // a visit also goes on the lane's cell list, and only it can be new
+        // to the team.
+        int firsts = _mm256_movemask_ps(_mm256_castsi256_ps(fresh));
+        if (firsts) {
+            _mm256_storeu_si256((__m256i*)slot_out, slot);
+            for (int f = firsts; f; f &= f - 1) {
+                int l = __builtin_ctz(f);
+                lane_visited[slot_out[l]] = (unsigned int)st.stamp[l];
+            }
+            int listed = firsts & (st.record_lanes | st.novel_lanes);
+            if (listed) _mm256_storeu_si256((__m256i*)pos_out, vpos);
+            for (; listed; listed &= listed - 1) {
+                int l = __builtin_ctz(listed);
+                if (st.record_lanes >> l & 1) st.cells[l][st.n_cells[l]++] = pos_out[l];
+                if (st.novel_lanes >> l & 1) st.novel[l] += explore_novel(pos_out[l], st.member[l]);
+            }
+        }
+
+        __m256i found = _mm256_and_si256(ok, _mm256_cmpeq_epi32(cell, survivor));
+        vsurv = _mm256_sub_epi32(vsurv, found);
+        vrisk = _mm256_sub_epi32(vrisk, _mm256_and_si256(ok, _mm256_cmpeq_epi32(cell, hazard)));
+
+        __m256i running = _mm256_andnot_si256(found, ok);
+        __m256i at_cp = _mm256_cmpeq_epi32(vcp_left, zero);
+        int checkpoint = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(running, at_cp))) &
+                         (int)st.record_lanes;
+        vcp_left = _mm256_blendv_epi8(vcp_left, vstride, at_cp);
+
+        __m256i ended = _mm256_or_si256(_mm256_or_si256(invalid, found),
+                                        _mm256_andnot_si256(_mm256_cmpgt_epi32(vlen, vgene), active));
+        int finished = _mm256_movemask_ps(_mm256_castsi256_ps(ended));
+
+        if (!checkpoint && !finished) continue;
+
+        STORE_LANES();
+
+        for (int l = 0; l < FITNESS_LANES; l++) {
+            if (!(checkpoint >> l & 1)) continue;
+            PathJob* job = &jobs[st.job[l]];
+            if (!job->checkpoints || st.n_cp[l] >= MAX_CHECKPOINTS) continue;
+            EvalCheckpoint* cp = &job->checkpoints[st.n_cp[l]++];
+            cp->gene = st.gene[l];
+            cp->pos = st.pos[l];
+            cp->coverage = st.cov[l];
+            cp->risk = st.risk[l];
+        }
+
+        if (!finished) continue;
+
+        int invalid_bits = _mm256_movemask_ps(_mm256_castsi256_ps(invalid));
+        for (int l = 0; l < FITNESS_LANES; l++) {
+            if (!(finished >> l & 1)) continue;
+            PathJob* job = &jobs[st.job[l]];
+            job->checkpoint_count = st.n_cp[l];
+
+            // simulated: everything walked since the resume point
+            int from = job->checkpoints && job->resume_count > 0 ?
+                       job->checkpoints[job->resume_count - 1].gene : 0;
+            job->simulated = st.gene[l] - from;
+
+            // the survivor step ends the walk without counting as a step
+            if (!(invalid_bits >> l & 1))
+                job->fitness = path_fitness(st.surv[l], st.cov[l], st.gene[l] - st.surv[l], st.risk[l],
+                                            st.novel[l]);
+            lane_load(&st, l, jobs, count, &next);
+        }
+
+        // only the refilled lanes' word registers are stale; left == 0 reloads them
+        LOAD_LANES();
+    }
+
+#undef LOAD_LANES
+#undef STORE_LANES
+}
+
+#endif
+
+int simd_fitness_available(void) {
+#ifdef HAVE_X86_SIMD
+    // lane stamp indices must fit in 32-bit gather offsets
+    return __builtin_cpu_supports("avx2") &&
+           (long long)grid_cells * FITNESS_LANES * sizeof(unsigned int) < 0x7fffffffLL;
+#else
+    return 0;
+#endif
+}
+
+void simulate_paths(PathJob* jobs, int count) {
+#ifdef HAVE_X86_SIMD
+    static __thread int use_simd = -1;
+    if (use_simd < 0) use_simd = SIMD_FITNESS && simd_fitness_available();
+
+    if (use_simd && grid && count > 1) {   // the gathers need the dense grid
+        simulate_lanes_avx2(jobs, count);
+        return;
+    }
+#endif
+    simulate_paths_scalar(jobs, count);
+}
+
+void simulate_release_thread(void) {
+    free(visited);
+    visited = NULL;
+    visited_cells = 0;
+    stamp = 0;
+#ifdef HAVE_X86_SIMD
+    free(lane_visited);
+    lane_visited = NULL;
+    lane_visited_cells = 0;
+    memset(lane_stamp, 0, sizeof(lane_stamp));
+#endif
+}
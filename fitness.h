@@ -0,0 +1,54 @@
+//fitness.h
+// Path simulation shared by the robot workers: walks a packed genome over the
+// voxel grid and scores it with W_SURVIVORS/W_COVERAGE/W_LENGTH/W_RISK.
+#ifndef FITNESS_H
+#define FITNESS_H
+
+#include "genetic.h"
+
+#define INVALID_FITNESS -10000.0
+
+// Simulates genes[0..length) from start and returns the fitness.
+// If resume_count > 0, checkpoints[resume_count-1] must describe this same
+// prefix and cells[] hold its first `coverage` cells: the walk restarts
+// there, marking those cells as visited without walking the prefix.
+// New checkpoints are written from checkpoints[resume_count] on (when
+// checkpoints is not NULL, and then cells needs MAX_PATH_LENGTH room), and
+// *checkpoint_count receives the total.
+// *simulated receives the number of genes actually scored.
+double simulate_path(const uint64_t* genes, int length, Point start,
+                     EvalCheckpoint* checkpoints, int* cells, int resume_count,
+                     int* checkpoint_count, int* simulated);
+
+// simulate_path() against the paged store (chunkmap.h) instead of grid
+double simulate_path_paged(const uint64_t* genes, int length, Point start);
+
+// ---- multi-path kernel ----
+#define FITNESS_LANES 8   // paths simulated in lock-step (one AVX2 register)
+
+extern int SIMD_FITNESS;  // config: 0 forces the scalar walk
+
+// One path for simulate_paths(): inputs as for simulate_path(), results filled in
+typedef struct {
+    const uint64_t* genes;
+    int length;
+    Point start;
+    EvalCheckpoint* checkpoints;
+    int* cells;
+    int resume_count;
+    int member;   // team member its novelty counts for (explore.h), -1 = none
+
+    double fitness;
+    int checkpoint_count;
+    int simulated;
+} PathJob;
+
+// Scores count paths. With AVX2 (and SIMD_FITNESS) they are walked
+// FITNESS_LANES at a time in lock-step; otherwise one by one with
+// simulate_path(). Both give bit-identical fitness and checkpoints.
+void simulate_paths(PathJob* jobs, int count);
+int simd_fitness_available(void);
+// frees the calling thread's walk scratch (threads backend, at thread exit)
+void simulate_release_thread(void);
+
+#endif
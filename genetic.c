@@ -7,6 +7,15 @@
 #include <time.h>
 #include "genetic.h"
 #include "multi.h" 
+#include "fitcache.h"
+#include "explore.h"
+#include "fitness.h"
+#include "netmig.h"
+#include "rng.h"
+#include "astar.h"
+#include "distfield.h"
+#include "spacetime.h"
+#include "team.h"
 #include <limits.h>    
 #include <string.h>    
 
@@ -17,127 +26,258 @@ extern double ELITE_PERCENT;
 extern double MUTATION_RATE;   // 10% chance
 extern double INJECT_PERCENT;  // percentage of new random paths per generation
 
+// Every heap allocation made by the GA goes through here, so a run can
+// check that the generation loop itself allocates nothing.
+long ga_heap_allocations = 0;
+// Allocations made while the generations ran (expected to be 0)
+long ga_loop_allocations = 0;
+
+// best fitness after every generation ([0] = initial population), when set
+double* ga_best_history = NULL;
+
+// this thread's breeding stream (see rng.h)
+__thread Rng ga_rng;
+
+void* ga_malloc(size_t size) {
+    void* p = malloc(size);
+    if (!p) { perror("malloc"); exit(1); }
+    ga_heap_allocations++;
+    return p;
+}
+
 Chromosome* genetic_algorithm() {
+    // team mode: one subpopulation per member, scored against each other
+    if (TEAM_MODE) return evolve_team();
+
+    // island mode: every robot evolves its own subpopulation, the parent
+    // only gathers the island bests
+    if (ISLAND_MODE && child_count > 0) return collect_islands();
+
+    return evolve_population();
+}
+
+// The GA loop itself. Runs in the parent (robots only score paths) or inside
+// an island, where children are scored in-process and migrants are swapped
+// with the neighbouring islands every MIGRATION_INTERVAL generations.
+Chromosome* evolve_population() {
     
     //start by creating the intial population
     Chromosome* population = create_new_population();
 
     //evaluate fitness of each individual in the population (via robots)
-    for(int i = 0; i < POPULATION_SIZE; i++){
-        population[i].fitness = evaluate_fitness(&population[i]);
-    }
+    evaluate_population(population, POPULATION_SIZE);
 
     int elite_count = (int)(POPULATION_SIZE * ELITE_PERCENT);
     if (elite_count < 1) elite_count = 1;
 
-    Chromosome* new_population = malloc(sizeof(Chromosome) * POPULATION_SIZE);
-    if (!new_population) {
-        perror("malloc");
-        exit(1);
-    }
+    // second slab: generations are bred into it and the two are swapped
+    Chromosome* new_population = alloc_population(POPULATION_SIZE);
+    int* ranking = ga_malloc(sizeof(int) * POPULATION_SIZE);
 
-    for (int gen = 0; gen < MAX_GENERATIONS; gen++) {
+    // elites and the tournament pool both come from the top of the ranking
+    int top_k = tournament_size();
+    if (elite_count > top_k) top_k = elite_count;
+    if (top_k > POPULATION_SIZE) top_k = POPULATION_SIZE;
 
-        // Sort population by fitness (descending)
-        sort_population(population);
+    // Rank the best top_k (descending fitness); done once per generation
+    rank_population(population, ranking, top_k);
 
-        if (gen == 0 || gen == MAX_GENERATIONS - 1 || (gen + 1) % 50 == 0) {
-        	printf("Generation %d | Best fitness = %.2f\n", gen + 1, population[0].fitness);
-        }
+    if (ga_best_history) ga_best_history[0] = population[ranking[0]].fitness;
+
+    net_migration_start();   // no-op unless MIGRATION_LISTEN is set
+    long allocs_before_loop = ga_heap_allocations;
+    long hits_before_gen = fitness_cache_hits;
 
-        // Copy elites directly to new population
-        for (int i = 0; i < elite_count; i++){
-            new_population[i] = population[i];
+    for (int gen = 0; gen < MAX_GENERATIONS; gen++) {
+
+        if (!IS_CHILD && (gen == 0 || gen == MAX_GENERATIONS - 1 || (gen + 1) % 50 == 0)) {
+        	printf("Generation %d | Best fitness = %.2f | round-trips saved by cache = %ld\n",
+        	       gen + 1, population[ranking[0]].fitness, fitness_cache_hits - hits_before_gen);
         }
+        hits_before_gen = fitness_cache_hits;
 
-        // Fill the rest of the population using crossover + mutation
-        for (int i = elite_count; i < POPULATION_SIZE; i++) {
+        breed_generation(population, ranking, new_population, elite_count);
 
-            double r = (double)rand() / RAND_MAX;
+        // Evaluate all children and injections of this generation at once (via
+        // IPC); with a novelty reward the elites too, as the team they were
+        // scored against may have changed since
+        if (W_NOVELTY != 0) evaluate_population(new_population, POPULATION_SIZE);
+        else evaluate_population(new_population + elite_count, POPULATION_SIZE - elite_count);
 
-            if (r < INJECT_PERCENT) {
-                // inject new exploratory path
-                Chromosome fresh = create_valid_individual();
-                fresh.fitness = evaluate_fitness(&fresh);
-                new_population[i] = fresh;
-                continue;
-            }
+        // Replace old population with new one
+        Chromosome* temp = population;      
+        population = new_population;
+        new_population = temp;
 
-            // Select parents
-            Chromosome* parents = select_parents(population);
+        rank_population(population, ranking, top_k);
 
-            // Crossover
-            Chromosome child = crossover(parents[0], parents[1]);
+        if (MIGRATION_INTERVAL > 0 && (gen + 1) % MIGRATION_INTERVAL == 0) {
+            int taken = IS_CHILD ? island_migrate(population, ranking) : 0;
+            taken += net_migrate(population, ranking);
+            if (taken) rank_population(population, ranking, top_k);
+        }
+
+        if (ga_best_history) ga_best_history[gen + 1] = population[ranking[0]].fitness;
+    }
+
+    ga_loop_allocations = ga_heap_allocations - allocs_before_loop;
+    net_migration_stop();
+
+    free_population(new_population);
+    free(ranking);
+        return population;
+}
 
-            // Mutation
-            mutate(&child);
+// Breeds the next generation of population (ranked by rank_population) into
+// new_population: the elite_count best are copied, the rest are injected
+// random walks or mutated children of tournament-selected parents.
+void breed_generation(const Chromosome* population, const int* ranking,
+                      Chromosome* new_population, int elite_count) {
+    // Copy elites directly to new population
+    for (int i = 0; i < elite_count; i++){
+        copy_chromosome(&new_population[i], &population[ranking[i]]);
+    }
 
-            // Evaluate fitness (via IPC)
-            child.fitness = evaluate_fitness(&child);
+    // Fill the rest of the population using crossover + mutation
+    for (int i = elite_count; i < POPULATION_SIZE; i++) {
 
-            new_population[i] = child;
+        double r = rng_unit(&ga_rng);
 
-            free(parents);
+        if (r < INJECT_PERCENT) {
+            // inject new exploratory path
+            create_valid_individual(&new_population[i]);
+            continue;
         }
 
-        // Replace old population with new one
-        Chromosome* temp = population;      
-        population = new_population;
-        new_population = temp;
+        // Select parents
+        int p1, p2;
+        select_parents(population, ranking, &p1, &p2);
+
+        // Crossover
+        crossover(&population[p1], &population[p2], &new_population[i]);
+
+        // Mutation
+        mutate(&new_population[i]);
     }
+}
 
-        return population;
+// One block holds the Chromosome array, the checkpoints, a packed gene slab
+// with room for MAX_PATH_LENGTH moves per individual and as many checkpoint
+// cells, so a population is a single free().
+Chromosome* alloc_population(int count) {
+    size_t header = sizeof(Chromosome) * count + sizeof(EvalCheckpoint) * MAX_CHECKPOINTS * count;
+    header = (header + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    size_t words = GENE_WORDS(MAX_PATH_LENGTH);
+    size_t cell_words = CELL_WORDS(MAX_PATH_LENGTH);
+    size_t slab = (size_t)count * (words + cell_words);
+
+    // with forked robots the genomes and cells live in shared memory, where
+    // the robots use them in place; otherwise they follow the header
+    uint64_t* genes = population_arena_alloc(slab);
+    char* block = ga_malloc(header + (genes ? 0 : sizeof(uint64_t) * slab));
+    Chromosome* population = (Chromosome*)block;
+    EvalCheckpoint* checkpoints = (EvalCheckpoint*)(population + count);
+    if (!genes) genes = (uint64_t*)(block + header);
+    int* cells = (int*)(genes + (size_t)count * words);
+
+    for (int i = 0; i < count; i++) {
+        population[i].genes = genes + (size_t)i * words;
+        population[i].checkpoints = checkpoints + (size_t)i * MAX_CHECKPOINTS;
+        population[i].cells = cells + (size_t)i * cell_words * 2;
+        population[i].checkpoint_count = 0;
+        population[i].length = 0;
+        population[i].fitness = 0.0;
+        population[i].start = (Point){0, 0, 0};
+    }
+    return population;
 }
 
-Chromosome* create_new_population(){
-    Chromosome* population = malloc(sizeof(Chromosome) * POPULATION_SIZE);
-    if (!population) {
-        perror("malloc");
-        exit(1);
+void free_population(Chromosome* population) {
+    if (!population) return;
+    population_arena_free(population[0].genes);
+    free(population);
+}
+
+// Each migrant replaces the current worst individual if it beats it; the
+// elites are never the worst, so they survive. Returns how many were taken.
+int take_migrants(Chromosome* population, const Chromosome* migrants, int count) {
+    int taken = 0;
+    for (int i = 0; i < count; i++) {
+        int worst = 0;
+        for (int j = 1; j < POPULATION_SIZE; j++)
+            if (population[j].fitness < population[worst].fitness) worst = j;
+        if (population[worst].fitness >= migrants[i].fitness) continue;
+
+        copy_chromosome(&population[worst], &migrants[i]);
+        taken++;
     }
+    return taken;
+}
 
-    for (int i = 0; i < POPULATION_SIZE; i++) {
-        population[i] = create_valid_individual();
+// Copies src into dst's own gene storage (dst->genes is kept)
+void copy_chromosome(Chromosome* dst, const Chromosome* src) {
+    memcpy(dst->genes, src->genes, sizeof(uint64_t) * GENE_WORDS(src->length));
+
+    int n = (dst->checkpoints && src->checkpoints) ? src->checkpoint_count : 0;
+    if (n) {
+        memcpy(dst->checkpoints, src->checkpoints, sizeof(EvalCheckpoint) * n);
+        memcpy(dst->cells, src->cells, sizeof(int) * src->checkpoints[n - 1].coverage);
     }
+    dst->checkpoint_count = n;
+    dst->length = src->length;
+    dst->fitness = src->fitness;
+    dst->start = src->start;
+}
+
+// initial population: SEEDING_GRADIENT of it walks down the survivor
+// distance field, SEEDING_ASTAR are A* paths, the rest random walks
+Chromosome* create_new_population(){
+    Chromosome* population = alloc_population(POPULATION_SIZE);
+
+    for (int i = 0; i < POPULATION_SIZE; i++)
+        create_seeded_individual(&population[i]);
 
     return population;
 }
 
-Chromosome create_valid_individual() {
-    Chromosome c;
+// one member of an initial population, drawn from the seeding mix
+void create_seeded_individual(Chromosome* c) {
+    double r = rng_unit(&ga_rng);
+    if (r < SEEDING_GRADIENT) create_gradient_individual(c);
+    else if (r < SEEDING_GRADIENT + SEEDING_ASTAR) create_astar_individual(c);
+    else create_valid_individual(c);
+}
+
+// Fills c (whose genes already have MAX_PATH_LENGTH room) with a random walk
+void create_valid_individual(Chromosome* out) {
+    Chromosome c = *out;
     c.length = MAX_PATH_LENGTH;
     c.fitness = 0.0;
-
-    c.moves = malloc(sizeof(Move) * c.length);
-    if (!c.moves) { perror("malloc"); exit(1); }
-
+    c.checkpoint_count = 0;
     // random start position on highest floor
     Point pos;
     pos.z = size_z - 1;
 
     do {
-        pos.x = rand() % size_x;
-        pos.y = rand() % size_y;
-    } while (grid[pos.z][pos.y][pos.x] == 1);
+        pos.x = rng_below(&ga_rng, size_x);
+        pos.y = rng_below(&ga_rng, size_y);
+    } while (MAP_CELL(pos.x, pos.y, pos.z) == 1);
 
     c.start = pos;
+    int idx = point_to_index(pos);
 
     for (int i = 0; i < c.length; i++) {
         int valid = 0;
         Move chosen = MOVE_POS_X;
 
         for (int attempt = 0; attempt < 20 && !valid; attempt++) {
-            Move m = rand() % 6;
-            Point next = apply_move(pos, m);
-
-            if (next.x >= 0 && next.x < size_x &&
-                next.y >= 0 && next.y < size_y &&
-                next.z >= 0 && next.z < size_z &&
-                grid[next.z][next.y][next.x] != 1) {
+            Move m = rng_below(&ga_rng, 6);
+            int next = idx + move_delta[m];
 
+            if (map_cell(next) != 1) {   // border cells are obstacles
                 valid = 1;
                 chosen = m;
-                pos = next;
+                idx = next;
             }
         }
 
@@ -146,7 +286,8 @@ Chromosome create_valid_individual() {
             break;
         }
 
-        c.moves[i] = chosen;
+        if (i % GENES_PER_WORD == 0) c.genes[i / GENES_PER_WORD] = 0;
+        set_move(&c, i, chosen);
        	
 	if (i + 1 >= size_x * size_y * size_z) {
     		c.length = i + 1;
@@ -154,165 +295,330 @@ Chromosome create_valid_individual() {
 	}
 
         // stop if robot finds survivor (only if discovered)
-        if (grid[pos.z][pos.y][pos.x] == 2) {   
+        if (map_cell(idx) == 2) {   
         	c.length = i + 1;
         	break;
         }
     }
 
-    return c;
+    *out = c;
 }
 
-// fitness computed by the robot via IPC
+// Like create_valid_individual, but each step goes downhill on the survivor
+// distance field with probability GRADIENT_FOLLOW, so the walk drifts
+// towards the nearest survivor instead of wandering.
+#define GRADIENT_FOLLOW 0.75
+
+void create_gradient_individual(Chromosome* out) {
+    Chromosome c = *out;
+    c.length = MAX_PATH_LENGTH;
+    c.fitness = 0.0;
+    c.checkpoint_count = 0;
+
+    Point pos;
+    pos.z = size_z - 1;
+    do {
+        pos.x = rng_below(&ga_rng, size_x);
+        pos.y = rng_below(&ga_rng, size_y);
+    } while (MAP_CELL(pos.x, pos.y, pos.z) == 1);
+
+    c.start = pos;
+    int idx = point_to_index(pos);
+
+    for (int i = 0; i < c.length; i++) {
+        Move open[6], downhill[6];
+        int n_open = 0, n_down = 0;
+        int here = distance_to_survivor(idx);
+
+        for (int m = 0; m < 6; m++) {
+            int next = idx + move_delta[m];
+            if (map_cell(next) == 1) continue;   // border cells are obstacles
+            open[n_open++] = (Move)m;
+            if (here > 0 && distance_to_survivor(next) < here) downhill[n_down++] = (Move)m;
+        }
+
+        if (n_open == 0) {
+            c.length = i;
+            break;
+        }
+
+        Move chosen = (n_down > 0 && rng_unit(&ga_rng) < GRADIENT_FOLLOW) ?
+                      downhill[rng_below(&ga_rng, n_down)] : open[rng_below(&ga_rng, n_open)];
+        idx += move_delta[chosen];
+
+        if (i % GENES_PER_WORD == 0) c.genes[i / GENES_PER_WORD] = 0;
+        set_move(&c, i, chosen);
+
+        if (map_cell(idx) == 2) {   // stop at the survivor, as the random walk does
+            c.length = i + 1;
+            break;
+        }
+    }
+
+    *out = c;
+}
+
+// fitness computed by the robot via IPC, unless this exact path was seen before
 double evaluate_fitness(Chromosome *c) {
-    return robot_evaluate_fitness(c->moves, c->length, c->start);
+    return evaluate_member_fitness(c, -1);
 }
 
-void sort_population(Chromosome* population) {
-    for (int i = 0; i < POPULATION_SIZE - 1; i++) {
-        for (int j = i + 1; j < POPULATION_SIZE; j++) {
-            if (population[j].fitness > population[i].fitness) {
-                Chromosome temp = population[i];
-                population[i] = population[j];
-                population[j] = temp;
-            }
-        }
+// the same, scored for team member `member` (-1: whoever's turn it is)
+double evaluate_member_fitness(Chromosome *c, int member) {
+    // with a novelty reward the score depends on the other members' paths
+    if (W_NOVELTY != 0) return robot_evaluate_fitness(c->genes, c->length, c->start, member);
+
+    uint64_t hash = chromosome_hash(c);
+    double f;
+
+    if (fitness_cache_lookup(hash, c->length, &f)) return f;
+
+    f = robot_evaluate_fitness(c->genes, c->length, c->start, member);
+    fitness_cache_store(hash, c->length, f);
+    return f;
+}
+
+// fitness of a whole generation: cached paths are answered locally and only
+// the misses are spread over all robots concurrently
+void evaluate_population(Chromosome *population, int count) {
+    static Chromosome **misses = NULL;
+    static uint64_t *hashes = NULL;
+    static int capacity = 0;
+
+    if (count <= 0) return;
+    if (capacity < count) {
+        free(misses);
+        free(hashes);
+        misses = ga_malloc(sizeof(Chromosome*) * count);
+        hashes = ga_malloc(sizeof(uint64_t) * count);
+        capacity = count;
     }
+
+    if (W_NOVELTY != 0) {   // not cacheable, see evaluate_member_fitness
+        for (int i = 0; i < count; i++) misses[i] = &population[i];
+        robot_evaluate_batch(misses, count);
+        return;
+    }
+
+    int nmiss = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t hash = chromosome_hash(&population[i]);
+        if (fitness_cache_lookup(hash, population[i].length, &population[i].fitness))
+            continue;
+        hashes[nmiss] = hash;
+        misses[nmiss++] = &population[i];
+    }
+
+    robot_evaluate_batch(misses, nmiss);
+
+    for (int i = 0; i < nmiss; i++)
+        fitness_cache_store(hashes[i], misses[i]->length, misses[i]->fitness);
 }
 
-int paths_are_identical(Chromosome a, Chromosome b) {
-    if (a.length != b.length) return 0;
+static int compare_fitness_desc(const void* a, const void* b) {
+    double fa = ((const Chromosome*)a)->fitness;
+    double fb = ((const Chromosome*)b)->fitness;
+    return (fa < fb) - (fa > fb);
+}
+
+void sort_population(Chromosome* population) {
+    qsort(population, POPULATION_SIZE, sizeof(Chromosome), compare_fitness_desc);
+}
 
-    for (int i = 0; i < a.length; i++) {
-        if (a.moves[i] != b.moves[i]) {
-            return 0;
+// (fitness, index) pair so ranking never moves whole Chromosome structs
+typedef struct {
+    double fitness;
+    int index;
+} RankEntry;
+
+// descending fitness, ties broken by index so the ranking is deterministic
+static int rank_before(const RankEntry* a, const RankEntry* b) {
+    if (a->fitness != b->fitness) return a->fitness > b->fitness;
+    return a->index < b->index;
+}
+
+static int compare_rank(const void* a, const void* b) {
+    const RankEntry* ra = a;
+    const RankEntry* rb = b;
+    if (rank_before(ra, rb)) return -1;
+    if (rank_before(rb, ra)) return 1;
+    return 0;
+}
+
+// Fills ranking[0..k-1] with the indices of the k fittest individuals, best
+// first. Quickselect moves the top k to the front in O(n), then only those k
+// are sorted: O(n + k log k) per generation instead of a full sort per child.
+void rank_population(const Chromosome* population, int* ranking, int k) {
+    static RankEntry* entries = NULL;
+    static int capacity = 0;
+    int n = POPULATION_SIZE;
+
+    if (capacity < n) {
+        free(entries);
+        entries = ga_malloc(sizeof(RankEntry) * n);
+        capacity = n;
+    }
+    if (k > n) k = n;
+    if (k <= 0) return;
+
+    for (int i = 0; i < n; i++) {
+        entries[i].fitness = population[i].fitness;
+        entries[i].index = i;
+    }
+
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        RankEntry pivot = entries[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (rank_before(&entries[i], &pivot)) i++;
+            while (rank_before(&pivot, &entries[j])) j--;
+            if (i <= j) {
+                RankEntry t = entries[i];
+                entries[i] = entries[j];
+                entries[j] = t;
+                i++;
+                j--;
+            }
         }
+        if (k - 1 <= j) hi = j;
+        else if (k - 1 >= i) lo = i;
+        else break;
     }
 
-    return 1;
+    qsort(entries, k, sizeof(RankEntry), compare_rank);
+    for (int i = 0; i < k; i++) ranking[i] = entries[i].index;
 }
 
-Chromosome* select_parents(Chromosome* population) {
-    Chromosome* parents = malloc(sizeof(Chromosome) * 2);
-    if (!parents) {
-        perror("malloc");
-        exit(1);
-    }
+// Tournament pool: the top 20% of the ranking
+int tournament_size(void) {
+    int K = POPULATION_SIZE / 5;
+    if (K < 2) K = 2;
+    if (K > POPULATION_SIZE) K = POPULATION_SIZE;
+    return K;
+}
 
-    
-    sort_population(population);
+int paths_are_identical(Chromosome a, Chromosome b) {
+    if (a.length != b.length) return 0;
 
+    // unused high bits are zero, so whole packed words compare directly
+    return memcmp(a.genes, b.genes, sizeof(uint64_t) * GENE_WORDS(a.length)) == 0;
+}
+
+// ranking must hold at least tournament_size() entries from rank_population();
+// *p1 and *p2 receive population indices
+void select_parents(const Chromosome* population, const int* ranking, int* p1, int* p2) {
     // Tournament size 
-    int K = POPULATION_SIZE / 5;   // top 20%
-    if (K < 2) K = 2;
+    int K = tournament_size();   // top 20%
 
     // --- Select parent 1 ---
-    int p1_idx = rand() % K;
-    parents[0] = population[p1_idx];
+    int p1_idx = rng_below(&ga_rng, K);
+    const Chromosome* first = &population[ranking[p1_idx]];
 
     // --- Select parent 2 (different & tolerant) ---
     int p2_idx;
     int attempts = 0;
 
     do {
-        p2_idx = rand() % K;
+        p2_idx = rng_below(&ga_rng, K);
         attempts++;
-    } while (paths_are_identical(population[p2_idx], parents[0]) &&
+    } while (paths_are_identical(population[ranking[p2_idx]], *first) &&
              attempts < 10);
 
     // Fallback safety
-    if (paths_are_identical(population[p2_idx], parents[0])) {
+    if (paths_are_identical(population[ranking[p2_idx]], *first)) {
         p2_idx = (p1_idx + 1) % K;
     }
 
-    parents[1] = population[p2_idx];
-
-    return parents;
+    *p1 = ranking[p1_idx];
+    *p2 = ranking[p2_idx];
 }
 
 
-Chromosome crossover(Chromosome p1, Chromosome p2) {
+// Writes the child of p1 and p2 into child's own gene storage
+void crossover(const Chromosome* p1, const Chromosome* p2, Chromosome* child) {
 
-    Chromosome child;
-
-    int min_len = (p1.length < p2.length) ? p1.length : p2.length;
+    int min_len = (p1->length < p2->length) ? p1->length : p2->length;
     if (min_len < 2) {
-        child = p1;
-        child.moves = malloc(sizeof(Move) * child.length);
-        if (!child.moves) { perror("malloc"); exit(1); }
-        for (int i = 0; i < child.length; i++)
-            child.moves[i] = p1.moves[i];
-        child.fitness = 0.0;
-        return child;
+        copy_chromosome(child, p1);
+        child->fitness = 0.0;
+        return;
     }
 
-    child.length = min_len;
-    child.fitness = 0.0;
-
-    child.moves = malloc(sizeof(Move) * min_len);
-    if (!child.moves) { perror("malloc"); exit(1); }
-
-    int cut = rand() % (min_len - 1);
-
-    for (int i = 0; i <= cut; i++)
-        child.moves[i] = p1.moves[i];
-
-    for (int i = cut + 1; i < min_len; i++)
-        child.moves[i] = p2.moves[i];
-
-    return child;
+    child->length = min_len;
+    child->fitness = 0.0;
+    child->start = p1->start;   // the prefix comes from p1, so does the start
+
+    int cut = rng_below(&ga_rng, (min_len - 1));
+
+    // the child walks exactly like p1 for its first cut+1 moves, so p1's
+    // checkpoints up to there (and their cells) stay valid and evaluation
+    // resumes from them
+    int keep = 0;
+    if (p1->checkpoints && child->checkpoints)
+        while (keep < p1->checkpoint_count && p1->checkpoints[keep].gene <= cut + 1) keep++;
+    if (keep) {
+        memcpy(child->checkpoints, p1->checkpoints, sizeof(EvalCheckpoint) * keep);
+        memcpy(child->cells, p1->cells, sizeof(int) * p1->checkpoints[keep - 1].coverage);
+    }
+    child->checkpoint_count = keep;
+
+    // genes 0..cut from p1, cut+1..min_len-1 from p2, a whole word at a time;
+    // only the word holding the cut is merged bit-wise
+    int cut_word = cut / GENES_PER_WORD;
+    int words = GENE_WORDS(min_len);
+    int low_bits = GENE_BITS * (cut % GENES_PER_WORD + 1);
+    uint64_t low_mask = ((uint64_t)1 << low_bits) - 1;
+
+    memcpy(child->genes, p1->genes, sizeof(uint64_t) * cut_word);
+    child->genes[cut_word] = (p1->genes[cut_word] & low_mask) | (p2->genes[cut_word] & ~low_mask);
+    memcpy(child->genes + cut_word + 1, p2->genes + cut_word + 1,
+           sizeof(uint64_t) * (words - cut_word - 1));
+
+    // p2 may be longer: clear genes past the child's end
+    int tail = min_len % GENES_PER_WORD;
+    if (tail) child->genes[words - 1] &= ((uint64_t)1 << (GENE_BITS * tail)) - 1;
 }
 
 void mutate(Chromosome* c) {
     if (c->length <= 2) return;
 
-    double r = (double)rand() / RAND_MAX;
+    double r = rng_unit(&ga_rng);
     if (r > MUTATION_RATE)
         return;
 
-    int idx = rand() % c->length;
-    c->moves[idx] = rand() % 6;
-}
+    int idx = rng_below(&ga_rng, c->length);
+    set_move(c, idx, rng_below(&ga_rng, 6));
 
-// Helper: opposite move to trace back
-static Move opposite_move(Move m) {
-    switch (m) {
-        case MOVE_POS_X: return MOVE_NEG_X;
-        case MOVE_NEG_X: return MOVE_POS_X;
-        case MOVE_POS_Y: return MOVE_NEG_Y;
-        case MOVE_NEG_Y: return MOVE_POS_Y;
-        case MOVE_POS_Z: return MOVE_NEG_Z;
-        case MOVE_NEG_Z: return MOVE_POS_Z;
-        default: return m;
-    }
+    // only the suffix after the mutated gene has to be simulated again
+    while (c->checkpoints && c->checkpoint_count > 0 &&
+           c->checkpoints[c->checkpoint_count - 1].gene > idx)
+        c->checkpoint_count--;
 }
 
 // A* pathfinding to nearest survivor 
-Chromosome create_path_with_astar(Point forced_start) {
-    Chromosome c;
-    c.length = 0;
-    c.fitness = 0.0;
-    c.start = forced_start;
-    c.moves = malloc(sizeof(Move) * MAX_PATH_LENGTH);
-    if (!c.moves) { perror("malloc"); exit(1); }
+// Fills c (genes with MAX_PATH_LENGTH room) with the A* path from forced_start
+static void astar_into(Chromosome* c, Point forced_start) {
+    static Move *moves = NULL;
+    static int moves_capacity = 0;
+
+    c->length = 0;
+    c->fitness = 0.0;
+    c->start = forced_start;
+    c->checkpoint_count = 0;
 
     // Find survivor with highest estimated fitness potential
     Point target = {-1, -1, -1};
     int max_potential = -1;
 
-    for (int z = 0; z < size_z; z++) {
-        for (int y = 0; y < size_y; y++) {
-            for (int x = 0; x < size_x; x++) {
-                if (grid[z][y][x] == 2) {  // survivor
-                    int dist = abs(x - forced_start.x) + abs(y - forced_start.y) + abs(z - forced_start.z);
-                    // Estimate fitness: survivor bonus + coverage gain - length penalty
-                    int potential = 6 * 1 + 2 * dist - 1 * dist;  // simplified: 6 + dist
-                    if (potential > max_potential) {
-                        max_potential = potential;
-                        target = (Point){x, y, z};
-                    }
-                }
-            }
+    for (int i = 0; i < survivor_count; i++) {
+        Point p = index_to_point(survivor_cells[i]);
+        int dist = abs(p.x - forced_start.x) + abs(p.y - forced_start.y) + abs(p.z - forced_start.z);
+        // Estimate fitness: survivor bonus + coverage gain - length penalty
+        int potential = 6 * 1 + 2 * dist - 1 * dist;  // simplified: 6 + dist
+        if (potential > max_potential) {
+            max_potential = potential;
+            target = p;
         }
     }
 
@@ -322,7 +628,7 @@ Chromosome create_path_with_astar(Point forced_start) {
         for (int z = 0; z < size_z; z++) {
             for (int y = 0; y < size_y; y++) {
                 for (int x = 0; x < size_x; x++) {
-                    if (grid[z][y][x] != 1) {  // free cell
+                    if (MAP_CELL(x, y, z) != 1) {  // free cell
                         int dist = abs(x - forced_start.x) + abs(y - forced_start.y) + abs(z - forced_start.z);
                         if (dist > max_dist) {
                             max_dist = dist;
@@ -334,118 +640,50 @@ Chromosome create_path_with_astar(Point forced_start) {
         }
     }
 
-    // A* implementation (6 directions, Manhattan heuristic)
-    typedef struct {
-        Point pos;
-        int g, h, f;
-        Move came_from_move;
-    } Node;
-
-    Node open[MAX_PATH_LENGTH];
-    int open_count = 0;
-
-    int closed[size_z][size_y][size_x];
-    memset(closed, 0, sizeof(closed));
-
-    Move parent_move[size_z][size_y][size_x];
-    memset(parent_move, 0, sizeof(parent_move));
-
-    // Start node
-    open[0].pos = forced_start;
-    open[0].g = 0;
-    open[0].h = abs(target.x - forced_start.x) + abs(target.y - forced_start.y) + abs(target.z - forced_start.z);
-    open[0].f = open[0].g + open[0].h;
-    open[0].came_from_move = 0;
-    open_count = 1;
-
-    Move directions[6] = {MOVE_POS_X, MOVE_NEG_X, MOVE_POS_Y, MOVE_NEG_Y, MOVE_POS_Z, MOVE_NEG_Z};
-    Point deltas[6] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
-
-    int found = 0;
-
-    while (open_count > 0 && c.length < MAX_PATH_LENGTH - 1) {
-        // Find lowest f node
-        int current_idx = 0;
-        for (int i = 1; i < open_count; i++) {
-            if (open[i].f < open[current_idx].f) current_idx = i;
-        }
-
-        Point curr = open[current_idx].pos;
-
-        // Remove from open
-        open[current_idx] = open[--open_count];
-
-        if (curr.x == target.x && curr.y == target.y && curr.z == target.z) {
-            found = 1;
-            break;
-        }
-
-        closed[curr.z][curr.y][curr.x] = 1;
-
-        for (int d = 0; d < 6; d++) {
-            Point next = {curr.x + deltas[d].x, curr.y + deltas[d].y, curr.z + deltas[d].z};
-
-            if (next.x < 0 || next.x >= size_x || next.y < 0 || next.y >= size_y ||
-                next.z < 0 || next.z >= size_z || grid[next.z][next.y][next.x] == 1 ||
-                closed[next.z][next.y][next.x]) {
-                continue;
-            }
-
-            int tentative_g = open[current_idx].g + 1;
-
-            int in_open = -1;
-            for (int i = 0; i < open_count; i++) {
-                if (open[i].pos.x == next.x && open[i].pos.y == next.y && open[i].pos.z == next.z) {
-                    in_open = i;
-                    break;
-                }
-            }
-
-            if (in_open == -1 || tentative_g < open[in_open].g) {
-                Node new_node;
-                new_node.pos = next;
-                new_node.g = tentative_g;
-                new_node.h = abs(next.x - target.x) + abs(next.y - target.y) + abs(next.z - target.z);
-                new_node.f = new_node.g + new_node.h;
-                new_node.came_from_move = directions[d];
-
-                if (in_open == -1) {
-                    open[open_count++] = new_node;
-                } else {
-                    open[in_open] = new_node;
-                }
-
-                parent_move[next.z][next.y][next.x] = directions[d];
-            }
-        }
+    // A* (6 directions) guided by the exact BFS distance to the target; if
+    // the target cannot be reached the path goes as close to it as possible
+    if (moves_capacity < MAX_PATH_LENGTH) {
+        free(moves);
+        moves = ga_malloc(sizeof(Move) * MAX_PATH_LENGTH);
+        moves_capacity = MAX_PATH_LENGTH;
     }
 
-    // Reconstruct path if goal reached or open exhausted
-    if (found || open_count > 0) {
-        Point current = found ? target : open[0].pos;  // go as far as possible if no path to goal
-        while (!(current.x == forced_start.x && current.y == forced_start.y && current.z == forced_start.z)) {
-            Move m = parent_move[current.z][current.y][current.x];
-            if (m == 0 && c.length > 0) break;  // safety
-            c.moves[c.length++] = m;
-            current = apply_move(current, opposite_move(m));
-        }
+    int goal = point_to_index(target);
+    c->length = astar_search(point_to_index(forced_start), goal,
+                             moves, MAX_PATH_LENGTH, distfield_from(goal));
+    memset(c->genes, 0, sizeof(uint64_t) * GENE_WORDS(c->length));
+    for (int i = 0; i < c->length; i++)
+        set_move(c, i, moves[i]);
+}
 
-        // Reverse moves to go from start to goal
-        for (int i = 0; i < c.length / 2; i++) {
-            Move temp = c.moves[i];
-            c.moves[i] = c.moves[c.length - 1 - i];
-            c.moves[c.length - 1 - i] = temp;
-        }
-    }
+Chromosome create_path_with_astar(Point forced_start) {
+    Chromosome c;
+    c.checkpoints = NULL;
+    c.cells = NULL;
+    c.genes = calloc(GENE_WORDS(MAX_PATH_LENGTH), sizeof(uint64_t));
+    if (!c.genes) { perror("calloc"); exit(1); }
 
+    astar_into(&c, forced_start);
     return c;
 }
 
+// A* path (see create_path_with_astar) from a random top-floor start
+void create_astar_individual(Chromosome* c) {
+    Point pos;
+    pos.z = size_z - 1;
+    do {
+        pos.x = rng_below(&ga_rng, size_x);
+        pos.y = rng_below(&ga_rng, size_y);
+    } while (MAP_CELL(pos.x, pos.y, pos.z) == 1);
+
+    astar_into(c, pos);
+}
+
 int is_free_cell(int x, int y, int z) {
     return (x >= 0 && x < size_x &&
             y >= 0 && y < size_y &&
             z >= 0 && z < size_z &&
-            grid[z][y][x] != 1);
+            MAP_CELL(x, y, z) != 1);
 }
 
 Point apply_move(Point p, Move m) {
@@ -462,107 +700,110 @@ Point apply_move(Point p, Move m) {
     return r;
 }
 
-// Collision detection between the 8 best paths
-CollisionReport detect_collisions(Chromosome team[8]) {
-    CollisionReport report = {0, 0, 0};
-    
-    int max_length = 0;
-    for (int i = 0; i < 8; i++) {
-        if (team[i].length > max_length) max_length = team[i].length;
-    }
+// Collision detection between the n team paths in one pass over every path:
+// (cell, t) occupancy, robots per cell and the move each robot makes at each
+// step go into space-time hash tables, so the cost is O(total path length).
+CollisionReport detect_collisions(const Chromosome* team, int n) {
+    CollisionReport report = {0, 0, 0, 0};
+
+    int total = 0;
+    for (int r = 0; r < n; r++) total += team[r].length + 1;
+
+    SpaceTimeTable occupied, cells, moves;
+    st_init(&occupied, total);
+    st_init(&cells, total);
+    st_init(&moves, total);
 
-    // Temporal collisions: same time step, same cell
-    for (int t = 0; t < max_length; t++) {
-        Point positions[8];
-        int valid[8] = {0};
-        
-        for (int r = 0; r < 8; r++) {
+    for (int r = 0; r < n; r++) {
+        int idx = point_to_index(team[r].start);
+
+        for (int t = 0; ; t++) {
+            // temporal: robots in the same cell before the same move; each
+            // newcomer collides with every robot already there
             if (t < team[r].length) {
-                Point pos = team[r].start;
-                for (int m = 0; m < t; m++) {
-                    pos = apply_move(pos, team[r].moves[m]);
-                }
-                positions[r] = pos;
-                valid[r] = 1;
+                SpaceTimeEntry *e = st_insert(&occupied, st_key(idx, t));
+                report.total_temporal_collisions += e->a;
+                e->a++;
             }
-        }
-        
-        for (int i = 0; i < 8; i++) {
-            if (!valid[i]) continue;
-            for (int j = i+1; j < 8; j++) {
-                if (!valid[j]) continue;
-                if (positions[i].x == positions[j].x &&
-                    positions[i].y == positions[j].y &&
-                    positions[i].z == positions[j].z) {
-                    report.total_temporal_collisions++;
-                }
+
+            // spatial: distinct robots that ever enter the cell
+            SpaceTimeEntry *c = st_insert(&cells, st_key(idx, 0));
+            if (c->b != r + 1) {
+                c->b = r + 1;
+                c->a++;
             }
-        }
-    }
 
-    // Spatial collisions: any cell visited by more than one robot
-    int visited[8][size_z][size_y][size_x];
-    memset(visited, 0, sizeof(visited));
-    
-    for (int r = 0; r < 8; r++) {
-        Point pos = team[r].start;
-        visited[r][pos.z][pos.y][pos.x] = 1;
-        
-        for (int i = 0; i < team[r].length; i++) {
-            pos = apply_move(pos, team[r].moves[i]);
-            visited[r][pos.z][pos.y][pos.x] = 1;
+            if (t == team[r].length) break;
+            int m = get_move(&team[r], t);
+            int next = idx + move_delta[m];
+            if (map_cell(next) == 1) break;   // invalid path: stop before leaving the map
+
+            // swap: another robot crossed the same edge the other way at the
+            // same step (m ^ 1 is the opposite move)
+            SpaceTimeEntry *s = st_find(&moves, st_edge_key(next, t, m ^ 1));
+            if (s) report.total_swap_conflicts += s->a;
+            st_insert(&moves, st_edge_key(idx, t, m))->a++;
+
+            idx = next;
         }
     }
-    
-    for (int z = 0; z < size_z; z++) {
-        for (int y = 0; y < size_y; y++) {
-            for (int x = 0; x < size_x; x++) {
-                int count = 0;
-                for (int r = 0; r < 8; r++) {
-                    if (visited[r][z][y][x]) count++;
-                }
-                if (count > 1) {
-                    report.total_spatial_collisions += (count - 1);
-                    report.conflicted_cells_count++;
-                }
-            }
+
+    for (unsigned int i = 0; i <= cells.mask; i++) {
+        if (cells.entries[i].key && cells.entries[i].a > 1) {
+            report.total_spatial_collisions += cells.entries[i].a - 1;
+            report.conflicted_cells_count++;
         }
     }
-    
+
+    st_free(&occupied);
+    st_free(&cells);
+    st_free(&moves);
     return report;
 }
 
 // Team fitness with collision penalty
-double evaluate_team_fitness(Chromosome team[8]) {
+double evaluate_team_fitness(const Chromosome* team, int n) {
     double total_survivors = 0, total_coverage = 0, total_length = 0, total_risk = 0;
-    
-    for (int i = 0; i < 8; i++) {
-        Point pos = team[i].start;
-        char visited[size_z][size_y][size_x];
-        memset(visited, 0, sizeof(visited));
-        
+
+    // cells each robot has covered: entry b holds the last robot seen there
+    SpaceTimeTable seen;
+    int total = 0;
+    for (int i = 0; i < n; i++) total += team[i].length + 1;
+    st_init(&seen, total);
+
+    for (int i = 0; i < n; i++) {
+        int idx = point_to_index(team[i].start);
+
         total_coverage++;
-        visited[pos.z][pos.y][pos.x] = 1;
-        
-        if (grid[pos.z][pos.y][pos.x] == 2) total_survivors++;
-        
+        st_insert(&seen, st_key(idx, 0))->b = i + 1;
+
+        if (map_cell(idx) == 2) total_survivors++;
+
         for (int m = 0; m < team[i].length; m++) {
-            pos = apply_move(pos, team[i].moves[m]);
+            idx += move_delta[get_move(&team[i], m)];
+            if (map_cell(idx) == 1) break;   // invalid path: stop before leaving the map
             total_length++;
-            
-            if (grid[pos.z][pos.y][pos.x] == 2) total_survivors++;
-            if (grid[pos.z][pos.y][pos.x] == 3) total_risk++;
-            
-            if (!visited[pos.z][pos.y][pos.x]) {
+
+            if (map_cell(idx) == 2) total_survivors++;
+            if (map_cell(idx) == 3) total_risk++;
+
+            SpaceTimeEntry *e = st_insert(&seen, st_key(idx, 0));
+            if (e->b != i + 1) {
                 total_coverage++;
-                visited[pos.z][pos.y][pos.x] = 1;
+                e->b = i + 1;
             }
         }
     }
-    
-    CollisionReport collisions = detect_collisions(team);
-    double collision_penalty = 50.0 * (collisions.total_temporal_collisions * 10 + 
-                                      collisions.total_spatial_collisions);
-    
-    return 8 * total_survivors + 2 * total_coverage - total_length - 5 * total_risk - collision_penalty;
-}
\ No newline at end of file
+    st_free(&seen);
+
+    double penalty = collision_penalty(detect_collisions(team, n));
+
+    return 8 * total_survivors + 2 * total_coverage - total_length - 5 * total_risk - penalty;
+}
+
+// what evaluate_team_fitness() takes off for these collisions; swaps are
+// head-on collisions, weighted like temporal ones
+double collision_penalty(CollisionReport c) {
+    return 50.0 * ((c.total_temporal_collisions + c.total_swap_conflicts) * 10 +
+                   c.total_spatial_collisions);
+}
@@ -1,56 +1,126 @@
 //genetic.h
 #ifndef GENETIC_H
 #define GENETIC_H
+#include <stddef.h>
 #include "graph.h"
 
-#define MAX_PATH_LIMIT 2000   // upper bound for paths stored in shared memory
-
 // External configuration variables (defined in main.c, loaded from config.txt)
 extern int POPULATION_SIZE;
 extern int MAX_GENERATIONS;
 extern double ELITE_PERCENT;
 extern double MUTATION_RATE;
 extern double INJECT_PERCENT;
+extern double SEEDING_GRADIENT;   // share of the initial population seeded down the distance field
+extern double SEEDING_ASTAR;      // share seeded with A* paths (the rest: random walks)
+extern int TEAM_MODE;             // 1 = co-evolve the team against each other's paths (team.c)
 
 // Fitness weights (external from main.c)
 extern double W_SURVIVORS;
 extern double W_COVERAGE;
 extern double W_LENGTH;
 extern double W_RISK;
+extern double W_NOVELTY;   // per cell on no other team member's path (explore.h); 0 = off
 typedef enum {
     MOVE_POS_X, MOVE_NEG_X,
     MOVE_POS_Y, MOVE_NEG_Y,
     MOVE_POS_Z, MOVE_NEG_Z
 } Move;
 
+// Genomes are bit-packed: 3 bits per move, 21 moves per 64-bit word (the top
+// bit is unused). Bits past `length` are always zero, so whole words can be
+// copied and compared directly.
+#define GENE_BITS        3
+#define GENES_PER_WORD   21
+#define GENE_WORDS(len)  (((len) + GENES_PER_WORD - 1) / GENES_PER_WORD)
+#define CELL_WORDS(len)  (((size_t)(len) * sizeof(int) + sizeof(uint64_t) - 1) / sizeof(uint64_t))   // checkpoint cells, in words
+
+// Snapshot of a path simulation after `gene` moves, so a child sharing that
+// prefix can resume there. No survivor has been reached yet at a checkpoint
+// (the walk stops at one) and the length count equals `gene`. A walk lays
+// one down every checkpoint_stride(length) genes, whole packed words so a
+// resumed walk starts on a fresh word, and at most MAX_CHECKPOINTS of them:
+// long paths get far-apart checkpoints rather than none past the 16th word.
+#define MAX_CHECKPOINTS 16
+
+static inline int checkpoint_stride(int length) {
+    int words = (GENE_WORDS(length) + MAX_CHECKPOINTS - 1) / MAX_CHECKPOINTS;
+    return GENES_PER_WORD * (words > 1 ? words : 1);
+}
+
 typedef struct {
-    Move* moves;    
+    int gene;       // moves applied so far
+    int pos;        // cell index after those moves
+    int coverage;   // distinct cells entered so far: cells[0..coverage) of the path
+    int risk;       // risk cells entered so far
+} EvalCheckpoint;
+
+typedef struct {
+    uint64_t* genes;    
     int length;
     double fitness;
         Point start;
+    EvalCheckpoint* checkpoints;   // MAX_CHECKPOINTS room, or NULL
+    int checkpoint_count;          // leading checkpoints valid for these genes
+    // with checkpoints: the cells the walk entered, each once, in the order it
+    // first did (MAX_PATH_LENGTH room), so a resume marks a checkpoint's
+    // cells without walking its prefix again
+    int* cells;
 } Chromosome;
 
+static inline Move get_move(const Chromosome* c, int i) {
+    return (Move)((c->genes[i / GENES_PER_WORD] >> (GENE_BITS * (i % GENES_PER_WORD))) & 7);
+}
+
+static inline void set_move(Chromosome* c, int i, Move m) {
+    int shift = GENE_BITS * (i % GENES_PER_WORD);
+    uint64_t* w = &c->genes[i / GENES_PER_WORD];
+    *w = (*w & ~((uint64_t)7 << shift)) | ((uint64_t)m << shift);
+}
+
+// heap allocation accounting for the GA (see ga_malloc in genetic.c)
+extern long ga_heap_allocations;
+extern long ga_loop_allocations;
+// when set, evolve_population stores the best fitness of every generation
+// here (MAX_GENERATIONS + 1 entries, [0] = initial population)
+extern double* ga_best_history;
+void* ga_malloc(size_t size);
+
 typedef struct {
     int total_spatial_collisions;
     int total_temporal_collisions;
     int conflicted_cells_count;
+    int total_swap_conflicts;       // two robots trading cells in one step
 } CollisionReport;
 
-CollisionReport detect_collisions(Chromosome team[8]);
-double evaluate_team_fitness(Chromosome team[8]);
+CollisionReport detect_collisions(const Chromosome* team, int n);
+double evaluate_team_fitness(const Chromosome* team, int n);
+double collision_penalty(CollisionReport c);
 Chromosome* genetic_algorithm();
+Chromosome* evolve_population();
+int take_migrants(Chromosome* population, const Chromosome* migrants, int count);
 Chromosome* create_new_population();
-Chromosome create_valid_individual();
+void create_seeded_individual(Chromosome* c);   // one draw from the SEEDING_* mix
+Chromosome* alloc_population(int count);
+void free_population(Chromosome* population);   // count >= 1
+void copy_chromosome(Chromosome* dst, const Chromosome* src);
+void create_valid_individual(Chromosome* c);
+void create_gradient_individual(Chromosome* c);   // walks down the survivor distance field
+void create_astar_individual(Chromosome* c);
 Chromosome create_path_with_astar();
 double evaluate_fitness(Chromosome* c);
-Chromosome* select_parents(Chromosome* population);
-Chromosome crossover(Chromosome p1, Chromosome p2);
+double evaluate_member_fitness(Chromosome* c, int member);
+void evaluate_population(Chromosome* population, int count);
+void select_parents(const Chromosome* population, const int* ranking, int* p1, int* p2);
+void crossover(const Chromosome* p1, const Chromosome* p2, Chromosome* child);
 void mutate(Chromosome* c);
+void breed_generation(const Chromosome* population, const int* ranking,
+                      Chromosome* new_population, int elite_count);
 int is_free_cell(int x, int y, int z);
 int paths_are_identical(Chromosome a, Chromosome b);
 void sort_population(Chromosome* population);
+void rank_population(const Chromosome* population, int* ranking, int k);
+int tournament_size(void);
 Point apply_move(Point p, Move m);
-static Move opposite_move(Move m);
 //static Chromosome clone_chromosome(const Chromosome *src);
 ////static void free_chromosome(Chromosome *c);
 
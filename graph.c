@@ -1,76 +1,336 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "graph.h"
+#include "distfield.h"
+#include "chunkmap.h"
+#include "rlemap.h"
 int MAX_PATH_LENGTH;    //it will be calculated based on the map size
-int ***grid = NULL;
+uint8_t *grid = NULL;
 int size_x = 0, size_y = 0, size_z = 0;
-int ***ExplorationMap = NULL; //the robot will explore and add to it this is the one will be used 
+int grid_cells = 0;
+int stride_y = 0, stride_z = 0;
+int move_delta[6];   // order of Move: +x -x +y -y +z -z
 
+int point_to_index(Point p){
+    return CELL_INDEX(p.x, p.y, p.z);
+}
 
-// -----------------  3D Grid (calculating the map floors)-----------------
-void load_3d_map(const char* filename){
-    FILE* fp = fopen(filename,"r");
-    if(!fp){ perror("Cannot open map"); exit(1); }
-
-//calculating map size
-    size_z = 0; size_y = 0; size_x = 0;
-    char line[1024];
-    int current_level_rows = 0;
-
-    while(fgets(line,sizeof(line),fp)){
-        if(strcmp(line,"\n")==0){
-            size_z++;
-            if(current_level_rows>size_y) size_y = current_level_rows;
-            current_level_rows = 0;
-        } else current_level_rows++;
-        if(size_x==0 && line[0]!='\n'){
-            char* token = strtok(line," ");
-            while(token){ size_x++; token=strtok(NULL," "); }
-        }
+Point index_to_point(int idx){
+    Point p;
+    p.z = idx / stride_z - 1;
+    p.y = (idx % stride_z) / stride_y - 1;
+    p.x = idx % stride_y - 1;
+    return p;
+}
+
+
+// map bytes mapped straight from a .vox file (see load_vox), or NULL when
+// grid was malloc'ed
+static void *grid_mapping = NULL;
+static size_t grid_mapping_len = 0;
+
+// sizes, strides and move deltas for a size_x * size_y * size_z map; the
+// padded grid must be indexable by int and fit in physical memory, since
+// every map is loaded dense (see load_chunked)
+static void set_dimensions(int sx, int sy, int sz){
+    long long padded = (long long)sx + 2;
+    if(sx < 1 || sy < 1 || sz < 1 ||
+       padded > (INT_MAX - GRID_SLACK) / ((long long)sy + 2) ||
+       (padded *= (long long)sy + 2) > (INT_MAX - GRID_SLACK) / ((long long)sz + 2)){
+        fprintf(stderr, "Map %dx%dx%d is too big: the padded grid must hold under %d cells\n",
+                sx, sy, sz, INT_MAX - GRID_SLACK);
+        exit(1);
     }
-    if(current_level_rows>0){ size_z++; if(current_level_rows>size_y) size_y = current_level_rows; }
-    rewind(fp);
+    padded *= (long long)sz + 2;
+    long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+    if(pages > 0 && page_size > 0 && padded + GRID_SLACK > (long long)pages * page_size){
+        fprintf(stderr, "Map %dx%dx%d needs %lld MB as a grid but only %lld MB of memory is installed\n",
+                sx, sy, sz, (padded + GRID_SLACK) >> 20, ((long long)pages * page_size) >> 20);
+        exit(1);
+    }
+    size_x = sx; size_y = sy; size_z = sz;
 
-//daynamic 3D
-    grid = malloc(size_z * sizeof(int**));
-    for(int z=0; z<size_z; z++){
-        grid[z] = malloc(size_y * sizeof(int*));
+//one flat padded array: border cells are obstacles
+    stride_y = size_x + 2;
+    stride_z = stride_y * (size_y + 2);
+    grid_cells = stride_z * (size_z + 2);
+
+    move_delta[0] =  1;        move_delta[1] = -1;
+    move_delta[2] =  stride_y; move_delta[3] = -stride_y;
+    move_delta[4] =  stride_z; move_delta[5] = -stride_z;
+
+    // longest path: one move per cell, but at most PATH_LENGTH_CAP, so a huge
+    // map does not make every genome as big as the map
+    long cells = (long)size_x * size_y * size_z;
+    MAX_PATH_LENGTH = cells < PATH_LENGTH_CAP ? (int)cells : PATH_LENGTH_CAP;
+}
+
+// padded grid with every cell an obstacle and the map cells free
+static void alloc_grid(void){
+    grid = malloc(grid_cells + GRID_SLACK);
+    if(!grid){ perror("malloc"); exit(1); }
+    memset(grid, 1, grid_cells + GRID_SLACK);
+    for(int z=0; z<size_z; z++)
         for(int y=0; y<size_y; y++)
-            grid[z][y] = malloc(size_x * sizeof(int));
+            memset(&GRID(0, y, z), 0, size_x);
+}
+
+static const char* map_file(const char* filename, size_t* len){
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0){ perror("Cannot open map"); exit(1); }
+    struct stat st;
+    if(fstat(fd, &st) < 0){ perror("fstat"); exit(1); }
+    *len = st.st_size;
+    if(*len == 0){ fprintf(stderr, "Empty map file '%s'\n", filename); exit(1); }
+
+    void* data = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED){ perror("mmap"); exit(1); }
+    close(fd);
+    return data;
+}
+
+// -----------------  text maps: one pass over the mapped file -----------------
+// Rows of space separated cell values, levels separated by a blank line. The
+// first row sets size_x (longer rows are cut, shorter ones padded with free
+// cells); size_y is the most rows any level has.
+static void parse_text_map(const char* p, size_t len){
+    const char* end = p + len;
+
+    // the first row's width, by counting its values
+    const char* q = p;
+    int width = 0;
+    while(q < end && (*q < '0' || *q > '9')) q++;
+    while(q < end && *q != '\n'){
+        if(*q >= '0' && *q <= '9'){
+            width++;
+            while(q < end && *q >= '0' && *q <= '9') q++;
+        } else q++;
     }
+    if(width == 0){ fprintf(stderr, "Map has no cells\n"); exit(1); }
+
+    uint8_t* rows = NULL;            // every row, width cells each, in file order
+    long row_count = 0, row_capacity = 0;
+    int* level_rows = NULL;          // rows in each level
+    int levels = 0, level_capacity = 0, in_level = 0, most_rows = 0;
 
-//reading the values
-    int z=0, y=0;
-    while(fgets(line,sizeof(line),fp)){
-        if(strcmp(line,"\n")==0){ z++; y=0; continue; }
-        int x=0;
-        char* token = strtok(line," ");
-        while(token){
-            grid[z][y][x] = atoi(token);
-            token = strtok(NULL," ");
-            x++;
+    while(p < end){
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+
+        if(p == end || *p == '\n'){
+            // blank line: the level (if any) ends here
+            if(in_level){
+                if(levels == level_capacity){
+                    level_capacity = level_capacity ? 2 * level_capacity : 16;
+                    level_rows = realloc(level_rows, sizeof(int) * level_capacity);
+                    if(!level_rows){ perror("realloc"); exit(1); }
+                }
+                level_rows[levels++] = in_level;
+                if(in_level > most_rows) most_rows = in_level;
+                in_level = 0;
+            }
+            p++;
+            continue;
         }
-        y++;
+
+        if(row_count == row_capacity){
+            row_capacity = row_capacity ? 2 * row_capacity : 256;
+            rows = realloc(rows, (size_t)row_capacity * width);
+            if(!rows){ perror("realloc"); exit(1); }
+        }
+        uint8_t* row = rows + (size_t)row_count * width;
+        memset(row, 0, width);
+
+        int x = 0;
+        while(p < end && *p != '\n'){
+            if(*p >= '0' && *p <= '9'){
+                int v = 0;
+                while(p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+                if(x < width) row[x] = (uint8_t)v;
+                x++;
+            } else p++;
+        }
+        p++;   // the row's newline
+        row_count++;
+        in_level++;
     }
+    if(in_level){
+        if(levels == level_capacity){
+            level_rows = realloc(level_rows, sizeof(int) * (level_capacity + 1));
+            if(!level_rows){ perror("realloc"); exit(1); }
+        }
+        level_rows[levels++] = in_level;
+        if(in_level > most_rows) most_rows = in_level;
+    }
+
+    set_dimensions(width, most_rows, levels);
+    alloc_grid();
 
-    fclose(fp);
-    ////////////////////should be removed 
-    // calculate path length
-    MAX_PATH_LENGTH = size_x * size_y * size_z;
+    long r = 0;
+    for(int z=0; z<levels; z++)
+        for(int y=0; y<level_rows[z]; y++, r++)
+            memcpy(&GRID(0, y, z), rows + (size_t)r * width, width);
 
-    // Allocate ExplorationMap with -1 = unknown
-    ExplorationMap = malloc(size_z * sizeof(int**));
+    free(rows);
+    free(level_rows);
+}
 
-    for (int z = 0; z < size_z; z++) {
-    ExplorationMap[z] = malloc(size_y * sizeof(int*));
-    for (int y = 0; y < size_y; y++) {
-        ExplorationMap[z][y] = malloc(size_x * sizeof(int));
-        for (int x = 0; x < size_x; x++)
-            ExplorationMap[z][y][x] = -1;  // unknown
+// -----------------  .vox maps (see graph.h) -----------------
+static void load_vox(const char* data, size_t len, const char* filename){
+    const VoxHeader* h = (const VoxHeader*)data;
+    if(h->version != VOX_VERSION || h->size_x == 0 || h->size_y == 0 || h->size_z == 0){
+        fprintf(stderr, "Unsupported .vox map '%s'\n", filename);
+        exit(1);
     }
+    set_dimensions(h->size_x, h->size_y, h->size_z);
+
+    size_t cells_len = (h->flags & VOX_PACKED_2BIT) ?
+        ((size_t)size_x * size_y * size_z + 3) / 4 : (size_t)grid_cells + GRID_SLACK;
+    size_t need = sizeof(VoxHeader) + VOX_ALIGN(cells_len) +
+                  ((h->flags & VOX_SURVIVORS) ? sizeof(int32_t) * h->survivor_count : 0);
+    if(len < need){
+        fprintf(stderr, "Truncated .vox map '%s'\n", filename);
+        exit(1);
+    }
+    const uint8_t* cells = (const uint8_t*)data + sizeof(VoxHeader);
+
+    if(h->flags & VOX_PACKED_2BIT){
+        // four cells per byte, x fastest, unpadded
+        alloc_grid();
+        size_t i = 0;
+        for(int z=0; z<size_z; z++)
+            for(int y=0; y<size_y; y++){
+                uint8_t* row = &GRID(0, y, z);
+                for(int x=0; x<size_x; x++, i++)
+                    row[x] = (cells[i >> 2] >> (2 * (i & 3))) & 3;
+            }
+    } else {
+        // the padded grid itself: nothing to parse
+        grid = (uint8_t*)cells;
+        grid_mapping = (void*)data;
+        grid_mapping_len = len;
+    }
+
+    if(h->flags & VOX_SURVIVORS)
+        distfield_build((const int32_t*)(cells + VOX_ALIGN(cells_len)), h->survivor_count);
+    else
+        distfield_build(NULL, 0);
+}
+
+// -----------------  chunked maps (see chunkmap.h) -----------------
+// Pages the whole map in, one row at a time through the chunk cache; the
+// mission runs on the dense grid, so set_dimensions rejects maps that do not fit
+static void load_chunked(const char* filename){
+    chunkmap_open(filename, (long)CHUNK_CACHE_MB << 20);
+    set_dimensions(chunk_size_x, chunk_size_y, chunk_size_z);
+    alloc_grid();
+    for(int z=0; z<size_z; z++)
+        for(int y=0; y<size_y; y++){
+            uint8_t* row = &GRID(0, y, z);
+            for(int x=0; x<size_x; x++) row[x] = chunkmap_cell(x, y, z);
+        }
+    chunkmap_close();
 }
 
+// -----------------  3D Grid (calculating the map floors)-----------------
+void load_3d_map(const char* filename){
+    size_t len;
+    const char* data = map_file(filename, &len);
+    grid_mapping = NULL;
+
+    if(len >= sizeof(VoxHeader) && memcmp(data, VOX_MAGIC, 4) == 0){
+        load_vox(data, len, filename);
+    } else if(len >= sizeof(ChunkHeader) && memcmp(data, CHUNK_MAGIC, 4) == 0){
+        load_chunked(filename);
+        distfield_build(NULL, 0);
+    } else {
+        parse_text_map(data, len);
+        distfield_build(NULL, 0);
+    }
+    if(!grid_mapping) munmap((void*)data, len);
+
+    if(MAP_BACKEND == MAP_RLE){
+        if(rle_build()){
+            if(grid_mapping) munmap(grid_mapping, grid_mapping_len);
+            else free(grid);
+            grid = NULL;
+            grid_mapping = NULL;
+        } else {
+            fprintf(stderr, "Map rows too wide to run-length encode, keeping the dense grid\n");
+        }
+    }
+}
+
+// Writes the loaded map as .vox: the padded grid as is (mapped straight back
+// in by load_3d_map), or with packed = 1 four cells per byte, 4x smaller but
+// decoded on load. Both carry the survivor list, so the distance field build
+// does not have to look for them.
+void save_vox(const char* filename, int packed){
+    FILE* fp = fopen(filename, "wb");
+    if(!fp){ perror("Cannot write map"); exit(1); }
+
+    VoxHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, VOX_MAGIC, 4);
+    h.version = VOX_VERSION;
+    h.size_x = size_x; h.size_y = size_y; h.size_z = size_z;
+    h.flags = VOX_SURVIVORS | (packed ? VOX_PACKED_2BIT : 0);
+    h.survivor_count = survivor_count;
+    fwrite(&h, sizeof(h), 1, fp);
+
+    size_t cells_len;
+    if(packed){
+        cells_len = ((size_t)size_x * size_y * size_z + 3) / 4;
+        uint8_t* bits = calloc(cells_len, 1);
+        if(!bits){ perror("calloc"); exit(1); }
+        size_t i = 0;
+        for(int z=0; z<size_z; z++)
+            for(int y=0; y<size_y; y++)
+                for(int x=0; x<size_x; x++, i++)
+                    bits[i >> 2] |= (MAP_CELL(x, y, z) & 3) << (2 * (i & 3));
+        fwrite(bits, 1, cells_len, fp);
+        free(bits);
+    } else {
+        cells_len = (size_t)grid_cells + GRID_SLACK;
+        if(grid) fwrite(grid, 1, cells_len, fp);
+        else {
+            for(int i=0; i<grid_cells; i++) fputc(map_cell(i), fp);
+            for(int i=0; i<GRID_SLACK; i++) fputc(1, fp);
+        }
+    }
+
+    static const uint8_t zeros[VOX_ALIGN(1)] = {0};
+    fwrite(zeros, 1, VOX_ALIGN(cells_len) - cells_len, fp);
+    fwrite(survivor_cells, sizeof(int32_t), survivor_count, fp);
+
+    if(fclose(fp) != 0){ perror("Cannot write map"); exit(1); }
+}
+
+
+int map_ray_x(int idx, int dir){
+    if(!grid) return rle_ray_x(idx, dir);
+    int steps = 0;
+    if(grid[idx] == 1) return 0;
+    for(int i = idx + dir; grid[i] != 1; i += dir) steps++;   // the border stops it
+    return steps;
+}
+
+
+// -------------- free the map -----------------
+void free_3d_map(){
+    if(!grid_cells) return;
+    distfield_release();
+    rle_release();
+    if(grid_mapping) munmap(grid_mapping, grid_mapping_len);
+    else free(grid);
+    grid = NULL;
+    grid_mapping = NULL;
+    grid_cells = 0;
 }
 
 
@@ -79,7 +339,7 @@ void print_grid(){
     for(int z=0; z<size_z; z++){
         printf("Level Z=%d\n",z);
         for(int y=0;y<size_y;y++){
-            for(int x=0;x<size_x;x++) printf("%d ",grid[z][y][x]);
+            for(int x=0;x<size_x;x++) printf("%d ",MAP_CELL(x, y, z));
             printf("\n");
         }
         printf("\n");
@@ -1,16 +1,71 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct {
     int x, y, z;
 } Point;
 
+// The map is one contiguous voxel array with a one-cell obstacle border
+// around it, so a single move from any map cell never leaves the array and
+// the hot loops need no bounds checks: map_cell(idx) == 1 covers "off the map".
+// With MAP_BACKEND=rle the array is run-length encoded (rlemap.h) and grid
+// is NULL; readers go through map_cell(), which serves both.
 extern int size_x, size_y, size_z;
-extern int ***grid;//0 free 1 obstacle 2 survivor 3 risk
-extern int ***ExplorationMap; // and -1 for unknown
-extern int MAX_PATH_LENGTH;
+extern uint8_t *grid;//0 free 1 obstacle 2 survivor 3 risk; NULL if run-length encoded
+extern int grid_cells;          // padded cell count (array length)
+extern int stride_y, stride_z;  // padded row / level strides
+extern int move_delta[6];       // linear index delta for each Move
+extern int MAX_PATH_LENGTH;     // map cells, capped at PATH_LENGTH_CAP
+extern int PATH_LENGTH_CAP;     // config
+
+#define GRID_SLACK 4      // spare bytes after grid for the SIMD fitness kernel
+
+#define CELL_INDEX(x, y, z) (((z) + 1) * stride_z + ((y) + 1) * stride_y + ((x) + 1))
+#define GRID(x, y, z) grid[CELL_INDEX(x, y, z)]   // dense grid only (loaders)
+
+#define MAP_DENSE 0
+#define MAP_RLE   1
+extern int MAP_BACKEND;   // config: dense | rle, applied by load_3d_map
+
+uint8_t rle_cell(int idx);
+static inline uint8_t map_cell(int idx) {
+    return grid ? grid[idx] : rle_cell(idx);
+}
+#define MAP_CELL(x, y, z) map_cell(CELL_INDEX(x, y, z))
+
+// free cells from idx (exclusive) along +x (dir 1) or -x (dir -1) before the
+// first obstacle
+int map_ray_x(int idx, int dir);
+
+int point_to_index(Point p);
+Point index_to_point(int idx);
+
+// Binary map (.vox): a 64-byte header, then the cells, then optionally the
+// padded index of every survivor (int32). Cells are either the padded grid
+// byte for byte, GRID_SLACK included, so loading maps it and is done, or
+// (VOX_PACKED_2BIT) the unpadded map at 2 bits per cell, x fastest.
+#define VOX_MAGIC       "RVOX"
+#define VOX_VERSION     1
+#define VOX_PACKED_2BIT 1
+#define VOX_SURVIVORS   2
+#define VOX_ALIGN(n)    (((n) + 7) & ~(size_t)7)   // survivor list offset
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t size_x, size_y, size_z;
+    uint32_t flags;
+    uint32_t survivor_count;
+    uint32_t reserved[9];
+} VoxHeader;
 
+// text, .vox or chunked (told apart by the magic), mapped and read in one pass
 void load_3d_map(const char* filename);
+void save_vox(const char* filename, int packed);   // writes the loaded map
+void free_3d_map();
 void print_grid();
 
-#endif
\ No newline at end of file
+#endif
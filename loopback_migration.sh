@@ -0,0 +1,65 @@
+#!/bin/sh
+# Runs several rescue instances on one box that migrate elites to each other
+# over loopback TCP (node i sends to node i+1, the last one to node 0), then
+# prints every node's migration report.
+#
+#   ./loopback_migration.sh [instances] [generations] [map]
+#
+# BASE_PORT (default 47600) picks the ports; UNIX=1 uses Unix-domain sockets.
+set -e
+
+N=${1:-3}
+GENS=${2:-3000}
+MAP=${3:-map3d.txt}
+BASE_PORT=${BASE_PORT:-47600}
+
+ROOT=$(cd "$(dirname "$0")" && pwd)
+# always rebuild: a rescue binary in the tree may be older than the sources
+make -C "$ROOT" >/dev/null
+case "$MAP" in /*) ;; *) MAP="$ROOT/$MAP" ;; esac
+
+WORK=$(mktemp -d /tmp/rescue_loopback_XXXXXX)
+trap 'rm -rf "$WORK"' EXIT
+
+address() {
+    if [ "${UNIX:-0}" = 1 ]; then echo "unix:$WORK/node$1.sock"
+    else echo "127.0.0.1:$((BASE_PORT + $1))"; fi
+}
+
+i=0
+while [ $i -lt "$N" ]; do
+    dir="$WORK/node$i"
+    mkdir "$dir"
+    {
+        grep -v '^MIGRATION_LISTEN\|^MIGRATION_PEERS\|^MAX_GENERATIONS' "$ROOT/config.txt"
+        echo
+        echo "MAX_GENERATIONS=$GENS"
+        echo "MIGRATION_LISTEN=$(address $i)"
+        echo "MIGRATION_PEERS=$(address $(( (i + 1) % N )))"
+    } > "$dir/config.txt"
+    i=$((i + 1))
+done
+
+# every instance reads config.txt from its own directory
+i=0
+while [ $i -lt "$N" ]; do
+    (cd "$WORK/node$i" && echo n | "$ROOT/rescue" "$MAP" > out.txt 2>&1) &
+    i=$((i + 1))
+done
+wait
+
+status=0
+i=0
+while [ $i -lt "$N" ]; do
+    echo "node $i ($(address $i)):"
+    grep '^\[migration\]' "$WORK/node$i/out.txt" | sed 's/^/  /'
+    received=$(sed -n 's/.*received \([0-9]*\) frames.*/\1/p' "$WORK/node$i/out.txt")
+    if [ -z "$received" ] || [ "$received" -eq 0 ]; then
+        echo "  FAIL: no migrants arrived"
+        status=1
+    fi
+    i=$((i + 1))
+done
+
+[ $status -eq 0 ] && echo "loopback migration OK ($N instances)"
+exit $status
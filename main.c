@@ -5,9 +5,17 @@
 #include <ctype.h>    
 #include <time.h>
 #include "graph.h"
+#include "distfield.h"
+#include "chunkmap.h"
+#include "explore.h"
 #include "genetic.h"
 #include "multi.h"
 #include "visualize.h"
+#include "bench.h"
+#include "netmig.h"
+#include "fitcache.h"
+#include "rng.h"
+#include "cbs.h"
 
 // Global configuration variables
 int POPULATION_SIZE = 50;
@@ -15,13 +23,32 @@ int MAX_GENERATIONS = 200;
 double ELITE_PERCENT = 0.10;
 double MUTATION_RATE = 0.10;
 double INJECT_PERCENT = 0.30;
+double SEEDING_GRADIENT = 0.20;
+double SEEDING_ASTAR = 0.50;
+int TEAM_MODE = 0;
+int PATH_LENGTH_CAP = 65536;      // longest path, whatever the map size
+int CHUNK_CACHE_MB = 64;          // chunk cache of paged maps
+int MAP_BACKEND = MAP_DENSE;
+double REPAIR_DEADLINE_MS = 50;   // CBS repair of a colliding final team, 0 = off
 
 double W_SURVIVORS = 6.0;
 double W_COVERAGE = 2.0;
 double W_LENGTH = 1.0;
 double W_RISK = 5.0;
-
-int NUM_ROBOTS = 8;
+double W_NOVELTY = 0.0;
+
+unsigned long SEED = 0;         // 0 = from the clock, printed so a run can be repeated
+int NUM_ROBOTS = 0;            // 0 = one per available CPU
+int WORKER_IDLE_SECONDS = 10;   // <= 0 keeps idle robots forever
+int SIMD_FITNESS = 1;
+int EVAL_BACKEND = BACKEND_PROCESSES;
+
+int ISLAND_MODE = 0;
+int MIGRATION_INTERVAL = 10;
+int MIGRATION_COUNT = 2;
+int MIGRATION_TOPOLOGY = TOPOLOGY_RING;
+char MIGRATION_LISTEN[256] = "";
+char MIGRATION_PEERS[1024] = "";
 char GRID_FILE[256] = "map3d.txt";  
 
 // Function to read config file
@@ -52,11 +79,33 @@ void read_config(const char* filename) {
         else if (strcmp(key, "ELITE_PERCENT") == 0) ELITE_PERCENT = atof(val_start);
         else if (strcmp(key, "MUTATION_RATE") == 0) MUTATION_RATE = atof(val_start);
         else if (strcmp(key, "INJECT_PERCENT") == 0) INJECT_PERCENT = atof(val_start);
+        else if (strcmp(key, "SEEDING_GRADIENT") == 0) SEEDING_GRADIENT = atof(val_start);
+        else if (strcmp(key, "SEEDING_ASTAR") == 0) SEEDING_ASTAR = atof(val_start);
+        else if (strcmp(key, "TEAM_MODE") == 0) TEAM_MODE = atoi(val_start);
+        else if (strcmp(key, "PATH_LENGTH_CAP") == 0) PATH_LENGTH_CAP = atoi(val_start);
+        else if (strcmp(key, "CHUNK_CACHE_MB") == 0) CHUNK_CACHE_MB = atoi(val_start);
+        else if (strcmp(key, "MAP_BACKEND") == 0)
+            MAP_BACKEND = strcmp(val_start, "rle") == 0 ? MAP_RLE : MAP_DENSE;
+        else if (strcmp(key, "REPAIR_DEADLINE_MS") == 0) REPAIR_DEADLINE_MS = atof(val_start);
         else if (strcmp(key, "W_SURVIVORS") == 0) W_SURVIVORS = atof(val_start);
         else if (strcmp(key, "W_COVERAGE") == 0) W_COVERAGE = atof(val_start);
         else if (strcmp(key, "W_LENGTH") == 0) W_LENGTH = atof(val_start);
         else if (strcmp(key, "W_RISK") == 0) W_RISK = atof(val_start);
-        else if (strcmp(key, "NUM_ROBOTS") == 0) NUM_ROBOTS = atoi(val_start);
+        else if (strcmp(key, "W_NOVELTY") == 0) W_NOVELTY = atof(val_start);
+        else if (strcmp(key, "SEED") == 0) SEED = strtoul(val_start, NULL, 10);
+        else if (strcmp(key, "NUM_ROBOTS") == 0)
+            NUM_ROBOTS = strcmp(val_start, "auto") == 0 ? 0 : atoi(val_start);
+        else if (strcmp(key, "WORKER_IDLE_SECONDS") == 0) WORKER_IDLE_SECONDS = atoi(val_start);
+        else if (strcmp(key, "SIMD_FITNESS") == 0) SIMD_FITNESS = atoi(val_start);
+        else if (strcmp(key, "EVAL_BACKEND") == 0)
+            EVAL_BACKEND = strcmp(val_start, "threads") == 0 ? BACKEND_THREADS : BACKEND_PROCESSES;
+        else if (strcmp(key, "ISLAND_MODE") == 0) ISLAND_MODE = atoi(val_start);
+        else if (strcmp(key, "MIGRATION_INTERVAL") == 0) MIGRATION_INTERVAL = atoi(val_start);
+        else if (strcmp(key, "MIGRATION_COUNT") == 0) MIGRATION_COUNT = atoi(val_start);
+        else if (strcmp(key, "MIGRATION_TOPOLOGY") == 0)
+            MIGRATION_TOPOLOGY = strcmp(val_start, "random") == 0 ? TOPOLOGY_RANDOM : TOPOLOGY_RING;
+        else if (strcmp(key, "MIGRATION_LISTEN") == 0) strncpy(MIGRATION_LISTEN, val_start, sizeof(MIGRATION_LISTEN) - 1);
+        else if (strcmp(key, "MIGRATION_PEERS") == 0) strncpy(MIGRATION_PEERS, val_start, sizeof(MIGRATION_PEERS) - 1);
         else if (strcmp(key, "GRID_FILE") == 0) strncpy(GRID_FILE, val_start, sizeof(GRID_FILE) - 1);
     }
 
@@ -66,24 +115,95 @@ void read_config(const char* filename) {
 
 void print_path_from_moves(Chromosome c);
 
+// prints detect_collisions() and the team fitness; returns the collision count
+static int print_collision_report(const char* title, Chromosome* team)
+{
+    CollisionReport collisions = detect_collisions(team, TEAM_SIZE);
+    double team_fitness = evaluate_team_fitness(team, TEAM_SIZE);
+
+    printf("\n--- %s ---\n", title);
+    printf("Temporal collisions (same time, same cell): %d\n", collisions.total_temporal_collisions);
+    printf("Spatial conflicts (shared cells): %d (in %d distinct cells)\n",
+           collisions.total_spatial_collisions, collisions.conflicted_cells_count);
+    printf("Swap conflicts (two robots trading cells): %d\n", collisions.total_swap_conflicts);
+
+    printf("\nTeam Overall Fitness (with collision penalty): %.2f\n", team_fitness);
+
+    return collisions.total_temporal_collisions + collisions.total_spatial_collisions +
+           collisions.total_swap_conflicts;
+}
+
 int main(int argc, char* argv[])
 {
-    srand(time(NULL));
     read_config("config.txt");
+    if (SEED == 0) SEED = (unsigned long)time(NULL);
+    rng_seed(&ga_rng, SEED, 0);
+
+    // ./rescue --bench [map]  runs the performance benchmarks instead of a mission
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return run_benchmarks(argc > 2 ? argv[2] : NULL);
+
+    // ./rescue --convert in out [--2bit|--chunked]  writes any map as .vox or chunked
+    if (argc > 1 && strcmp(argv[1], "--convert") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "usage: %s --convert <in> <out> [--2bit|--chunked]\n", argv[0]);
+            return 1;
+        }
+        int packed = argc > 4 && strcmp(argv[4], "--2bit") == 0;
+        int chunked = argc > 4 && strcmp(argv[4], "--chunked") == 0;
+        load_3d_map(argv[2]);
+        if (chunked) chunkmap_save(argv[3]);
+        else save_vox(argv[3], packed);
+        printf("%s -> %s: %dx%dx%d, %d survivors%s\n", argv[2], argv[3],
+               size_x, size_y, size_z, survivor_count,
+               chunked ? ", chunked" : packed ? ", 2 bits/cell" : "");
+        free_3d_map();
+        return 0;
+    }
+
+    if (TEAM_MODE && ISLAND_MODE) {
+        printf("TEAM_MODE=1: ignoring ISLAND_MODE\n");
+        ISLAND_MODE = 0;
+    }
+    // a single island has nobody to migrate with: it is the plain GA in a fork
+    int islands = NUM_ROBOTS > 0 ? NUM_ROBOTS : available_cpus();
+    if (ISLAND_MODE && islands < 2) {
+        printf("ISLAND_MODE=1 needs at least 2 islands, got %d (NUM_ROBOTS=%s): "
+               "running master/worker instead\n", islands, NUM_ROBOTS > 0 ? "set" : "auto");
+        ISLAND_MODE = 0;
+    }
 
     const char* filename = (argc < 2) ? "map3d.txt" : argv[1];
     load_3d_map(filename);
+    printf("Seed: %lu\n", SEED);
 
-    init_robot_pool(8);
+    init_robot_pool(NUM_ROBOTS);
 
-    genetic_algorithm();   // robots evaluate & store best internally
+    free_population(genetic_algorithm());   // robots evaluate & store best internally
     printf("\nGenetic Algorithm completed %d generations.\n", MAX_GENERATIONS);
+    printf("Heap allocations during evolution: %ld\n", ga_loop_allocations);
+    printf("Fitness cache: %ld hits / %ld misses (%.1f robot round-trips saved per generation)\n",
+           fitness_cache_hits, fitness_cache_misses,
+           MAX_GENERATIONS ? (double)fitness_cache_hits / MAX_GENERATIONS : 0.0);
+    printf("Incremental evaluation: %ld genes scored, %ld skipped by resuming from checkpoints (%.1f%%)\n",
+           genes_simulated, genes_resumed,
+           genes_simulated + genes_resumed ?
+               100.0 * genes_resumed / (genes_simulated + genes_resumed) : 0.0);
+    printf("Robot pool: %d CPUs available, peak %d robots (%ld started, %ld retired idle)\n",
+           available_cpus(), robots_peak, robots_spawned, robots_retired);
+
+    long open_cells = 0;
+    for (int i = 0; i < grid_cells; i++) open_cells += map_cell(i) != 1;
+    long explored_cells = explore_count();
+    printf("Team exploration: %ld of %ld open cells on the team's paths, %.2f robots per such cell\n",
+           explored_cells, open_cells,
+           explored_cells ? (double)explore_count_members() / explored_cells : 0.0);
 
     printf("     FINAL RESCUE TEAM REPORT\n\n");
  
 
-    Chromosome team[8];
-    for (int i = 0; i < 8; i++) {
+    Chromosome team[TEAM_SIZE];
+    for (int i = 0; i < TEAM_SIZE; i++) {
         team[i] = get_best_for_robot(i);
         printf("Robot %d | Fitness: %.2f | Length: %d | Start: (%d,%d,%d)\n",
                i, team[i].fitness, team[i].length,
@@ -92,60 +212,94 @@ int main(int argc, char* argv[])
         print_path_from_moves(team[i]);
     }
    
-    CollisionReport collisions = detect_collisions(team);
-    double team_fitness = evaluate_team_fitness(team);
-
-    printf("\n--- Collision Report ---\n");
-    printf("Temporal collisions (same time, same cell): %d\n", collisions.total_temporal_collisions);
-    printf("Spatial conflicts (shared cells): %d (in %d distinct cells)\n",
-           collisions.total_spatial_collisions, collisions.conflicted_cells_count);
-
-    printf("\nTeam Overall Fitness (with collision penalty): %.2f\n", team_fitness);
+    int collided = print_collision_report("Collision Report", team);
+
+    // repair what evolution left: keep starts and end cells, replan only
+    // the robots in conflict
+    if (collided && REPAIR_DEADLINE_MS > 0) {
+        Chromosome* repaired = alloc_population(TEAM_SIZE);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int ok = cbs_repair(team, TEAM_SIZE, REPAIR_DEADLINE_MS, repaired);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+        if (ok) {
+            printf("\nCBS repair: %d robots replanned in %.2f ms (%ld search nodes)\n",
+                   cbs_replanned, ms, cbs_nodes);
+            // score every new path before changing the team: robot scoring
+            // still offers its results to the team members
+            int changed[TEAM_SIZE];
+            for (int i = 0; i < TEAM_SIZE; i++) {
+                changed[i] = !paths_are_identical(team[i], repaired[i]) ||
+                             team[i].start.x != repaired[i].start.x ||
+                             team[i].start.y != repaired[i].start.y ||
+                             team[i].start.z != repaired[i].start.z;
+                if (changed[i]) repaired[i].fitness = evaluate_member_fitness(&repaired[i], i);
+            }
+            for (int i = 0; i < TEAM_SIZE; i++) {
+                if (!changed[i]) continue;
+                set_best_for_robot(i, &repaired[i]);
+                team[i] = get_best_for_robot(i);
+                printf("Robot %d | Fitness: %.2f | Length: %d (replanned)\n",
+                       i, team[i].fitness, team[i].length);
+                printf("  Path: ");
+                print_path_from_moves(team[i]);
+            }
+            collided = print_collision_report("Collision Report after CBS repair", team);
+        } else {
+            printf("\nCBS repair: no collision-free team within %.0f ms (%ld search nodes)\n",
+                   REPAIR_DEADLINE_MS, cbs_nodes);
+        }
+        free_population(repaired);
+    }
 
-    if (collisions.total_temporal_collisions == 0 && collisions.total_spatial_collisions == 0) {
+    if (!collided) {
         printf("No collisions detected! Safe multi-robot deployment.\n");
     } else {
-        printf("Collisions detected. Consider re-running with different parameters.\n");
+        printf(TEAM_MODE ? "Collisions left. More generations may clear them.\n" :
+                           "Collisions detected. TEAM_MODE=1 evolves the team collision-free.\n");
     }
 
     printf("\n--- A* vs Genetic Algorithm Comparison (per robot) ---\n");
 
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < TEAM_SIZE; i++) {
         Chromosome ga_best = get_best_for_robot(i);
 
         // A* from same start
         Chromosome astar_path = create_path_with_astar(ga_best.start);
 
-        // Manual fitness calculation for A* (same as GA but without shared ExplorationMap effects)
+        // Manual fitness calculation for A* (same as GA but without the novelty reward)
         double astar_survivors = 0, astar_coverage = 0, astar_length = 0, astar_risk = 0;
-        Point a_pos = astar_path.start;
-        char a_visited[size_z][size_y][size_x];
-        memset(a_visited, 0, sizeof(a_visited));
+        int a_pos = point_to_index(astar_path.start);
+        char *a_visited = calloc(grid_cells, 1);
+        if (!a_visited) { perror("calloc"); exit(1); }
 
-        a_visited[a_pos.z][a_pos.y][a_pos.x] = 1;
+        a_visited[a_pos] = 1;
         astar_coverage++;
 
-        if (grid[a_pos.z][a_pos.y][a_pos.x] == 2) astar_survivors++;
+        if (map_cell(a_pos) == 2) astar_survivors++;
 
         int a_valid = 1;
         for (int m = 0; m < astar_path.length; m++) {
-            a_pos = apply_move(a_pos, astar_path.moves[m]);
+            a_pos += move_delta[get_move(&astar_path, m)];
 
-            if (!is_free_cell(a_pos.x, a_pos.y, a_pos.z)) {
+            if (map_cell(a_pos) == 1) {
                 a_valid = 0;
                 break;
             }
 
-            if (!a_visited[a_pos.z][a_pos.y][a_pos.x]) {
-                a_visited[a_pos.z][a_pos.y][a_pos.x] = 1;
+            if (!a_visited[a_pos]) {
+                a_visited[a_pos] = 1;
                 astar_coverage++;
             }
 
-            if (grid[a_pos.z][a_pos.y][a_pos.x] == 2) astar_survivors++;
-            if (grid[a_pos.z][a_pos.y][a_pos.x] == 3) astar_risk++;
+            if (map_cell(a_pos) == 2) astar_survivors++;
+            if (map_cell(a_pos) == 3) astar_risk++;
 
             astar_length++;
         }
+        free(a_visited);
 
         double astar_fitness = a_valid ? 
             W_SURVIVORS * astar_survivors + W_COVERAGE * astar_coverage - W_LENGTH * astar_length - W_RISK * astar_risk :
@@ -164,32 +318,21 @@ int main(int argc, char* argv[])
             printf("  → GA achieved %.1f%% of A* optimal fitness\n", ratio);
         }
 
-        free(astar_path.moves);
+        free(astar_path.genes);
     }
      printf("do you want to visualize the map? [y,n]");
     char v;
     scanf("%c",&v);
     if(v == 'y')
     {
-      visualize_paths_3d(team, 8);
+      visualize_paths_3d(team, TEAM_SIZE);
     }
 
 
     shutdown_robot_pool();
 
-    // Free the 3D grid and ExplorationMap
-    for (int z = 0; z < size_z; z++) {
-        for (int y = 0; y < size_y; y++) {
-            free(grid[z][y]);
-            free(ExplorationMap[z][y]);
-        }
-        free(grid[z]);
-        free(ExplorationMap[z]);
-    }
-    free(grid);
-    free(ExplorationMap);
-    grid = NULL;
-    ExplorationMap = NULL;
+    // Free the 3D grid
+    free_3d_map();
 
     return 0;
 }
@@ -200,7 +343,7 @@ void print_path_from_moves(Chromosome c)
     printf("(%d,%d,%d)", pos.x, pos.y, pos.z);
 
     for (int i = 0; i < c.length; i++) {
-        pos = apply_move(pos, c.moves[i]);
+        pos = apply_move(pos, get_move(&c, i));
         printf(" -> (%d,%d,%d)", pos.x, pos.y, pos.z);
     }
     printf("\n");
@@ -1,157 +1,741 @@
 //multi.c file
+#define _GNU_SOURCE   // sched_getaffinity, CPU_COUNT
 #include "multi.h"
+#include "queue.h"
+#include "fitness.h"
+#include "fitcache.h"
+#include "workpool.h"
+#include "rng.h"
+#include "explore.h"
 #include <sys/ipc.h>
 #include <sys/shm.h>
-
-// Commands for robots
-#define CMD_NONE    0
-#define CMD_EXPLORE 1
-#define CMD_EXIT    2
-// round-robin index for fair robot scheduling
-static int rr_index = 0;
-#define SEM_START(i) (i)
-#define SEM_DONE(i)  ((i) + MAX_ROBOTS)
-
+#include <sched.h>
+
+// Special job value telling a robot to exit
+#define JOB_EXIT   -1
+// what a robot leaving the pool answers JOB_EXIT with on the results ring
+#define JOB_RETIRED(id)  (-2 - (id))
+// Jobs in flight per robot (one shared-memory slot each): two full SIMD batches
+#define SLOTS_PER_ROBOT  (2 * FITNESS_LANES)
+#define MIN_JOB_SLOTS    64
+// the processes backend forks another robot for every this many queued jobs
+#define JOBS_PER_ROBOT   FITNESS_LANES
+// genomes from outside the arena that can be in flight at once (copied in)
+#define STAGED_PATHS     MIN_JOB_SLOTS
+
+// top migrants an island last published; seq is odd while it is rewritten.
+// genes: MAX_MIGRANTS paths of path_words each
+typedef struct {
+    unsigned int seq;
+    int count;
+    int length[MAX_MIGRANTS];
+    Point start[MAX_MIGRANTS];
+    double fitness[MAX_MIGRANTS];
+    uint64_t genes[];
+} MigrationBox;
+
+// written once by an island when its generations are done: its top paths,
+// best first, so a few islands can still field a whole team
 typedef struct {
-    int  cmd[MAX_ROBOTS];
-    int  chromosome_index[MAX_ROBOTS];
-    int  path_length[MAX_ROBOTS];
+    int count;
+    double fitness[TEAM_SIZE];
+    int length[TEAM_SIZE];
+    Point start[TEAM_SIZE];
 
-    int start_x[MAX_ROBOTS];
-    int start_y[MAX_ROBOTS];
-    int start_z[MAX_ROBOTS];
+    long genes_simulated, genes_resumed;
+    long cache_hits, cache_misses;
+    long loop_allocations;
+    long migrants_in;
 
-    Move moves[MAX_ROBOTS][MAX_PATH_LIMIT];
-    double fitness[MAX_ROBOTS];
+    uint64_t genes[];   // TEAM_SIZE paths of path_words each
+} IslandResult;
 
+// one job in flight: the genome stays where it is in the segment
+typedef struct {
+    size_t genes_at;   // word offset of the packed moves from the segment start
+    int path_length;
+    Point start;
+    int member;      // team member its novelty counts for, -1 = none
+
+    int robot_of;    // robot that evaluated the slot
+    double fitness;
+
+    // incremental evaluation: resume from checkpoint resume_count-1, robot
+    // appends the checkpoints it passes and reports how many genes it scored.
+    // The path's cell list stays in the arena (word offset, 0 = none: the
+    // job neither resumes nor lays checkpoints)
+    size_t cells_at;
+    int resume_count;
+    int checkpoint_count;
+    int simulated;
+    EvalCheckpoint checkpoints[MAX_CHECKPOINTS];
+} JobSlot;
+
+// Header of the shared segment. Everything it points to lives further down
+// the same segment, sized for the pool's robot limit; the segment is attached
+// before any fork, so the pointers are valid in every robot.
+typedef struct {
+    JobQueue *jobs;      // slots waiting for any robot (or JOB_EXIT)
+    JobQueue *results;   // slots whose fitness is ready (or JOB_RETIRED)
+    unsigned int *retire;   // per robot: set by aging() to retire that robot
+
+    int slot_count;
+    JobSlot *slots;
+
+    // island mode: each island's outbox, read by its neighbours (seqlock,
+    // so exchanges never block), and its final result; box_bytes and
+    // result_bytes apart, as they hold whole genomes
+    char *migration;
+    char *island;
+
+    // processes backend: the parent's populations keep their genomes here
+    // (alloc_population), and genomes from anywhere else are copied into
+    // one of the STAGED_PATHS staging areas while their job is in flight
+    uint64_t *arena;
+    size_t arena_words;
+    uint64_t *staging;
 } SharedState;
 
 static SharedState *shared = NULL;
 static int shmid = -1;
-static int semid  = -1;
+
+// every genome buffer in the segment has room for this many words: the
+// longest path on the map the pool was started for
+static size_t path_words = 0;
+static size_t box_bytes = 0, result_bytes = 0;
+
+static MigrationBox *migration_box(int id)
+{
+    return (MigrationBox *)(shared->migration + (size_t)id * box_bytes);
+}
+
+static IslandResult *island_result(int id)
+{
+    return (IslandResult *)(shared->island + (size_t)id * result_bytes);
+}
 
 int child_count = 0;
 int IS_CHILD = 0;
-ChildProcess *child_pool = NULL;
+ChildProcess *child_pool = NULL;   // pool_capacity entries, robot_id -1 = free
+static int pool_capacity = 0;
+
+long robots_spawned = 0;
+long robots_retired = 0;
+int robots_peak = 0;
+
+// best result per team member; jobs are dealt to members in the order they
+// are posted, so the team does not depend on which robot scored what
+static Chromosome best_per_robot[TEAM_SIZE];
+static int best_initialized[TEAM_SIZE] = {0};
+static long jobs_posted = 0;
+
+// parent side bookkeeping for the shared slots
+static int *job_of = NULL;       // batch index a busy slot holds
+static int *free_slots = NULL;
+static int *staged_in = NULL;    // staging area a busy slot holds, or -1
+static int free_staging[STAGED_PATHS];
+static int nstaging = 0;
+
+// genes scored by robots vs. prefix genes skipped by resuming from a
+// checkpoint
+long genes_simulated = 0;
+long genes_resumed = 0;
+
+// CPUs this process may run on: the affinity mask, capped by a cgroup CPU
+// quota (v2 cpu.max or v1 cfs_quota/cfs_period) rounded up
+int available_cpus(void)
+{
+    int cpus = 0;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) cpus = CPU_COUNT(&set);
+    if (cpus <= 0) cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 0) cpus = 1;
+
+    long quota = -1, period = 0;
+    FILE *fp = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if (fp) {
+        char max[32];
+        if (fscanf(fp, "%31s %ld", max, &period) == 2 && strcmp(max, "max") != 0)
+            quota = atol(max);
+        fclose(fp);
+    } else if ((fp = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r"))) {
+        if (fscanf(fp, "%ld", &quota) != 1) quota = -1;
+        fclose(fp);
+        if ((fp = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r"))) {
+            if (fscanf(fp, "%ld", &period) != 1) period = 0;
+            fclose(fp);
+        }
+    }
 
-// best result per robot
-static Chromosome best_per_robot[MAX_ROBOTS];
-static int best_initialized[MAX_ROBOTS] = {0};
+    if (quota > 0 && period > 0) {
+        int limit = (int)((quota + period - 1) / period);
+        if (limit < cpus) cpus = limit;
+    }
+    return cpus;
+}
 
-union semun {
-    int val;
-    struct semid_ds *buf;
-    unsigned short *array;
-};
+static void note_best(int member, const Chromosome *c)
+{
+    if (!best_initialized[member] || c->fitness > best_per_robot[member].fitness) {
+        copy_chromosome(&best_per_robot[member], c);
+        best_initialized[member] = 1;
+        explore_publish(member, c);
+    }
+}
 
-static struct sembuf sem_acquire = {0, -1, SEM_UNDO};
-static struct sembuf sem_release = {0,  1, SEM_UNDO};
+// member the next batch is scored for when >= 0 (robot_evaluate_fitness)
+static int batch_member = -1;
+
+// team member job i of a count-job batch is offered to, and whose novelty it
+// scores: the members take turns, but team mode evaluates the members'
+// subpopulations back to back (see evolve_team)
+static int job_member(int i, int count)
+{
+    if (batch_member >= 0) return batch_member;
+    if (TEAM_MODE) return (int)((long)i * TEAM_SIZE / count);
+    return (int)((jobs_posted + i) % TEAM_SIZE);
+}
+
+static int novelty_member(int i, int count)
+{
+    return W_NOVELTY != 0 ? job_member(i, count) : -1;
+}
+
+// in job order, not completion order, so ties always go the same way; the
+// members get their new bests only now, so a batch scores its novelty
+// against one team
+static void note_batch_bests(Chromosome **batch, int count)
+{
+    if (!TEAM_MODE)
+        for (int i = 0; i < count; i++)
+            note_best(job_member(i, count), batch[i]);
+    jobs_posted += count;
+}
+
+// team mode decides the members itself (see evolve_team)
+void set_best_for_robot(int member, const Chromosome *c)
+{
+    copy_chromosome(&best_per_robot[member], c);
+    best_initialized[member] = 1;
+    explore_publish(member, c);
+}
+
+// tell the parent which robot is leaving, so it can reap the right pid
+static void robot_retire(int robot_id)
+{
+    queue_push(shared->results, JOB_RETIRED(robot_id));
+    _exit(0);
+}
 
 static void robot_worker_loop(int robot_id)
 {
     IS_CHILD = 1;
 
     while (1) {
-        sem_acquire.sem_num = SEM_START(robot_id);
-        semop(semid, &sem_acquire, 1);
+        // block for one job, then take whatever else is queued (up to a full
+        // set of lanes) so the kernel can walk several paths at once
+        int slots[FITNESS_LANES];
+        PathJob batch[FITNESS_LANES];
+        int n = 0, quit = 0;
+
+        if (!queue_pop_wait_unless(shared->jobs, &slots[n], &shared->retire[robot_id]) ||
+            slots[n] == JOB_EXIT)
+            robot_retire(robot_id);
+        n++;
+        while (n < FITNESS_LANES && queue_try_pop(shared->jobs, &slots[n])) {
+            if (slots[n] == JOB_EXIT) { quit = 1; break; }
+            n++;
+        }
 
-        int cmd = shared->cmd[robot_id];
-        if (cmd == CMD_EXIT) _exit(0);
+        for (int j = 0; j < n; j++) {
+            JobSlot *s = &shared->slots[slots[j]];
+            batch[j].genes = (uint64_t *)shared + s->genes_at;
+            batch[j].length = s->path_length;
+            batch[j].start = s->start;
+            batch[j].checkpoints = s->cells_at ? s->checkpoints : NULL;
+            batch[j].cells = s->cells_at ? (int *)((uint64_t *)shared + s->cells_at) : NULL;
+            batch[j].resume_count = s->resume_count;
+            batch[j].member = s->member;
+        }
 
-        if (cmd == CMD_EXPLORE) {
-            int length = shared->path_length[robot_id];
-            Move *moves = shared->moves[robot_id];
+        simulate_paths(batch, n);
 
-            Point pos = {
-                shared->start_x[robot_id],
-                shared->start_y[robot_id],
-                shared->start_z[robot_id]
-            };
+        for (int j = 0; j < n; j++) {
+            JobSlot *s = &shared->slots[slots[j]];
+            s->fitness = batch[j].fitness;
+            s->checkpoint_count = batch[j].checkpoint_count;
+            s->simulated = batch[j].simulated;
+            s->robot_of = robot_id;
+            queue_push(shared->results, slots[j]);
+        }
 
-            double survivors = 0, coverage = 0, risk = 0, length_penalty = 0;
+        if (quit) robot_retire(robot_id);
+    }
+}
 
-            int total = size_x * size_y * size_z;
-            char *visited = calloc(total, 1);
+static int in_arena(const uint64_t *genes)
+{
+    return shared && shared->arena_words && genes >= shared->arena &&
+           genes < shared->arena + shared->arena_words;
+}
 
-            for (int i = 0; i < length; i++) {
-                pos = apply_move(pos, moves[i]);
+// describe one job in a shared slot and publish it to whichever robot is
+// free; genes outside the arena go through staging area `staged` (else -1)
+static void post_job(int slot, const Chromosome *c, int staged, int member)
+{
+    JobSlot *s = &shared->slots[slot];
+    s->path_length = c->length;
+    s->start = c->start;
+    s->member = member;
+
+    const uint64_t *genes = c->genes;
+    if (staged >= 0) {
+        uint64_t *copy = shared->staging + (size_t)staged * path_words;
+        memcpy(copy, genes, sizeof(uint64_t) * GENE_WORDS(c->length));
+        genes = copy;
+    }
+    s->genes_at = genes - (uint64_t *)shared;
+
+    // checkpoint cells outside the arena cannot be shared: a whole walk
+    int with_cells = c->checkpoints && in_arena((const uint64_t *)c->cells);
+    s->cells_at = with_cells ? (const uint64_t *)c->cells - (uint64_t *)shared : 0;
+    int resume = with_cells ? c->checkpoint_count : 0;
+    s->resume_count = resume;
+    if (resume > 0)
+        s->checkpoints[resume - 1] = c->checkpoints[resume - 1];
 
-                if (!is_free_cell(pos.x, pos.y, pos.z)) {
-                    shared->fitness[robot_id] = -10000.0;
-                    goto done;
-                }
+    queue_push(shared->jobs, slot);
+}
 
-                int idx = pos.z * size_y * size_x + pos.y * size_x + pos.x;
-                int cell = grid[pos.z][pos.y][pos.x];
+// read back a finished job
+static void collect_job(int slot, Chromosome *c)
+{
+    JobSlot *s = &shared->slots[slot];
+    double f = s->fitness;
+    c->fitness = f;
 
-                ExplorationMap[pos.z][pos.y][pos.x] = cell;
+    int resume = s->resume_count;
+    int count = s->checkpoint_count;
+    if (c->checkpoints && count > resume)
+        memcpy(c->checkpoints + resume, s->checkpoints + resume,
+               sizeof(EvalCheckpoint) * (count - resume));
+    if (c->checkpoints) c->checkpoint_count = count;
 
-                if (!visited[idx]) {
-                    visited[idx] = 1;
-                    coverage++;
-                }
+    genes_simulated += s->simulated;
+    if (resume > 0) genes_resumed += c->checkpoints[resume - 1].gene;
 
-                if (cell == 2) {
-                    survivors++;
-                    break;
-                }
-                if (cell == 3) risk++;
+    child_pool[s->robot_of].last_used = time(NULL);
+}
 
-                length_penalty++;
-            }
+// an island scores its own children, and the parent does once no robot is
+// left (islands collected): no queue round-trip. Scores batch[from] up to
+// batch[count - 1].
+static void evaluate_in_process(Chromosome **batch, int from, int count)
+{
+    static PathJob *jobs = NULL;
+    static int capacity = 0;
+
+    if (capacity < count) {
+        free(jobs);
+        jobs = ga_malloc(sizeof(PathJob) * count);
+        capacity = count;
+    }
+
+    for (int i = from; i < count; i++) {
+        Chromosome *c = batch[i];
+        jobs[i] = (PathJob){ .genes = c->genes, .length = c->length, .start = c->start,
+                             .checkpoints = c->checkpoints, .cells = c->cells,
+                             .resume_count = c->checkpoints ? c->checkpoint_count : 0,
+                             .member = novelty_member(i, count) };
+    }
+
+    simulate_paths(jobs + from, count - from);
+
+    for (int i = from; i < count; i++) {
+        Chromosome *c = batch[i];
+        c->fitness = jobs[i].fitness;
+        if (c->checkpoints) c->checkpoint_count = jobs[i].checkpoint_count;
+
+        genes_simulated += jobs[i].simulated;
+        if (jobs[i].resume_count > 0)
+            genes_resumed += c->checkpoints[jobs[i].resume_count - 1].gene;
+    }
+}
+
+/* ---- threads backend: robots are threads reading genomes in place ---- */
+
+#define THREAD_CHUNK_MAX 256   // chromosomes per stealable task
+
+static int using_threads = 0;
+
+typedef struct {
+    Chromosome **batch;
+    int count;
+    int chunk;
+} ThreadBatch;
 
-	    shared->fitness[robot_id] = 
-                  W_SURVIVORS * survivors +
-                  W_COVERAGE * coverage -
-                  W_LENGTH * length_penalty -
-                  W_RISK * risk;
+// per robot thread, each on its own cache line
+typedef struct {
+    long genes_simulated;
+    long genes_resumed;
+} __attribute__((aligned(64))) ThreadCounters;
+
+static ThreadCounters *thread_counters = NULL;
+
+static void evaluate_chunk(int robot, int task, void *arg)
+{
+    ThreadBatch *tb = arg;
+    PathJob jobs[THREAD_CHUNK_MAX];
+    int first = task * tb->chunk;
+    int n = tb->count - first < tb->chunk ? tb->count - first : tb->chunk;
+
+    for (int i = 0; i < n; i++) {
+        Chromosome *c = tb->batch[first + i];
+        jobs[i] = (PathJob){ .genes = c->genes, .length = c->length, .start = c->start,
+                             .checkpoints = c->checkpoints, .cells = c->cells,
+                             .resume_count = c->checkpoints ? c->checkpoint_count : 0,
+                             .member = novelty_member(first + i, tb->count) };
+    }
+
+    simulate_paths(jobs, n);
+
+    ThreadCounters *counters = &thread_counters[robot];
+    for (int i = 0; i < n; i++) {
+        Chromosome *c = tb->batch[first + i];
+        c->fitness = jobs[i].fitness;
+        if (c->checkpoints) c->checkpoint_count = jobs[i].checkpoint_count;
+
+        counters->genes_simulated += jobs[i].simulated;
+        if (jobs[i].resume_count > 0)
+            counters->genes_resumed += c->checkpoints[jobs[i].resume_count - 1].gene;
+    }
+    child_pool[robot].last_used = time(NULL);
+}
+
+static void threads_evaluate_batch(Chromosome **batch, int count)
+{
+    // a few tasks per thread so stealing can even out uneven path lengths,
+    // and at least a full set of SIMD lanes per task
+    int chunk = count / (child_count * 4);
+    if (chunk < FITNESS_LANES) chunk = FITNESS_LANES;
+    if (chunk > THREAD_CHUNK_MAX) chunk = THREAD_CHUNK_MAX;
+
+    ThreadBatch tb = { batch, count, chunk };
+    workpool_run((count + chunk - 1) / chunk, &tb);
+
+    for (int i = 0; i < child_count; i++) {
+        genes_simulated += thread_counters[i].genes_simulated;
+        genes_resumed += thread_counters[i].genes_resumed;
+        thread_counters[i].genes_simulated = thread_counters[i].genes_resumed = 0;
+    }
+
+    note_batch_bests(batch, count);
+}
+
+// processes backend: fork robots until there is one per JOBS_PER_ROBOT jobs
+static void grow_pool(int backlog)
+{
+    int wanted = (backlog + JOBS_PER_ROBOT - 1) / JOBS_PER_ROBOT;
+    if (wanted > pool_capacity) wanted = pool_capacity;
+    while (child_count < wanted) create_child();
+}
 
-        done:
-            free(visited);
+// Retire every robot that has not finished a job in max_idle seconds. Each
+// one gets its own retire flag, so only those robots leave, never one that was
+// busy. Call between batches.
+void aging(int max_idle)
+{
+    if (using_threads || ISLAND_MODE || child_count == 0) return;
+
+    time_t now = time(NULL);
+    int idle = 0;
+    for (int i = 0; i < pool_capacity; i++)
+        if (child_pool[i].robot_id >= 0 && now - child_pool[i].last_used >= max_idle) {
+            __atomic_store_n(&shared->retire[i], 1, __ATOMIC_SEQ_CST);
+            idle++;
         }
+    if (idle == 0) return;
+
+    // the robots kept take over the retired ones' share: their idle time
+    // starts over, so one shrink does not cascade into the next pass
+    for (int i = 0; i < pool_capacity; i++)
+        if (child_pool[i].robot_id >= 0 && !shared->retire[i]) child_pool[i].last_used = now;
+
+    queue_wake_all(shared->jobs);
+    for (int i = 0; i < idle; i++) {
+        int id = JOB_RETIRED(queue_pop_wait(shared->results));
+        waitpid(child_pool[id].pid, NULL, 0);
+        shared->retire[id] = 0;
+        child_pool[id].pid = 0;
+        child_pool[id].robot_id = -1;
+        child_count--;
+        robots_retired++;
+    }
+}
 
-        sem_release.sem_num = SEM_DONE(robot_id);
-        semop(semid, &sem_release, 1);
+// Evaluate a whole batch: jobs stream through the shared job queue to every
+// robot, and each result frees its slot for the next job.
+void robot_evaluate_batch(Chromosome **batch, int count)
+{
+    int nfree = 0, next = 0, pending = 0;
+
+    if (IS_CHILD) {   // an island: its own team, see island_loop
+        evaluate_in_process(batch, 0, count);
+        note_batch_bests(batch, count);
+        return;
+    }
+    if (using_threads && child_count > 0) {
+        threads_evaluate_batch(batch, count);
+        return;
     }
+
+    if (WORKER_IDLE_SECONDS > 0) aging(WORKER_IDLE_SECONDS);
+    // islands are not ring robots: once collected, none are left to fork
+    if (shared && !ISLAND_MODE) grow_pool(count);
+
+    // no robot to send the jobs to: score them here
+    if (child_count == 0) {
+        evaluate_in_process(batch, 0, count);
+        note_batch_bests(batch, count);
+        return;
+    }
+
+    for (int s = shared->slot_count - 1; s >= 0; s--) free_slots[nfree++] = s;
+
+    while (next < count || pending > 0) {
+        while (next < count && nfree > 0) {
+            // a genome outside the arena waits for a free staging area
+            int staged = -1;
+            if (!in_arena(batch[next]->genes)) {
+                if (nstaging == 0) break;
+                staged = free_staging[--nstaging];
+            }
+            int slot = free_slots[--nfree];
+            job_of[slot] = next;
+            staged_in[slot] = staged;
+            post_job(slot, batch[next], staged, novelty_member(next, count));
+            next++;
+            pending++;
+        }
+
+        if (pending == 0) break;   // nothing in flight to wait for
+        int slot = queue_pop_wait(shared->results);
+        collect_job(slot, batch[job_of[slot]]);
+        if (staged_in[slot] >= 0) free_staging[nstaging++] = staged_in[slot];
+        free_slots[nfree++] = slot;
+        pending--;
+    }
+    if (next < count) evaluate_in_process(batch, next, count);
+
+    note_batch_bests(batch, count);
+}
+
+double robot_evaluate_fitness(uint64_t *genes, int length, Point start, int member)
+{
+    Chromosome c;
+    c.genes = genes;
+    c.checkpoints = NULL;
+    c.cells = NULL;
+    c.checkpoint_count = 0;
+    c.length = length;
+    c.start = start;
+    c.fitness = -10000.0;
+
+    Chromosome *job = &c;
+    batch_member = member;
+    robot_evaluate_batch(&job, 1);
+    batch_member = -1;
+    return c.fitness;
+}
+
+/* ---- island mode ---- */
+
+static int same_path(const Chromosome *a, const Chromosome *b)
+{
+    return a->start.x == b->start.x && a->start.y == b->start.y && a->start.z == b->start.z &&
+           paths_are_identical(*a, *b);
 }
 
-double robot_evaluate_fitness(Move *moves, int length, Point start)
+int island_id = -1;   // which island this process is, -1 outside island mode
+static int island_count = 0;
+static unsigned int *migrants_seen = NULL;   // last seq taken from each box
+static long migrants_in = 0;
+static Chromosome *immigrants = NULL;
+
+int island_migrate(Chromosome *population, const int *ranking)
 {
-    int id = get_free_child();
-    if (id < 0) return -10000.0;
+    int count = MIGRATION_COUNT;
+    if (count > MAX_MIGRANTS) count = MAX_MIGRANTS;
+    if (count > POPULATION_SIZE) count = POPULATION_SIZE;
+    if (count <= 0 || island_count < 2) return 0;
+
+    // publish our best: seq goes odd while the box is inconsistent
+    MigrationBox *out = migration_box(island_id);
+    __atomic_add_fetch(&out->seq, 1, __ATOMIC_ACQ_REL);
+    for (int i = 0; i < count; i++) {
+        const Chromosome *c = &population[ranking[i]];
+        out->length[i] = c->length;
+        out->start[i] = c->start;
+        out->fitness[i] = c->fitness;
+        memcpy(out->genes + i * path_words, c->genes, sizeof(uint64_t) * GENE_WORDS(c->length));
+    }
+    out->count = count;
+    __atomic_add_fetch(&out->seq, 1, __ATOMIC_RELEASE);
+
+    int from;
+    if (MIGRATION_TOPOLOGY == TOPOLOGY_RANDOM) {
+        from = rng_below(&ga_rng, island_count - 1);
+        if (from >= island_id) from++;
+    } else {
+        from = (island_id + island_count - 1) % island_count;
+    }
 
-    shared->cmd[id] = CMD_EXPLORE;
-    shared->path_length[id] = length;
+    // copy the neighbour's box; skip it if it is mid-write or already taken
+    MigrationBox *in = migration_box(from);
+    unsigned int seq = __atomic_load_n(&in->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0 || (seq & 1) || seq == migrants_seen[from]) return 0;
+
+    int n = in->count;
+    if (n > count) n = count;
+    for (int i = 0; i < n; i++) {
+        immigrants[i].length = in->length[i];
+        immigrants[i].start = in->start[i];
+        immigrants[i].fitness = in->fitness[i];
+        immigrants[i].checkpoint_count = 0;
+        memcpy(immigrants[i].genes, in->genes + i * path_words, sizeof(uint64_t) * GENE_WORDS(in->length[i]));
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&in->seq, __ATOMIC_RELAXED) != seq) return 0;
+    migrants_seen[from] = seq;
 
-    shared->start_x[id] = start.x;
-    shared->start_y[id] = start.y;
-    shared->start_z[id] = start.z;
+    int taken = take_migrants(population, immigrants, n);
+    migrants_in += taken;
+    return taken;
+}
 
-    for (int i = 0; i < length; i++)
-        shared->moves[id][i] = moves[i];
+static void island_loop(int id)
+{
+    IS_CHILD = 1;
+    island_id = id;
+    // forked islands would share the parent's stream: give each its own
+    rng_seed(&ga_rng, SEED, id + 1);
+
+    immigrants = alloc_population(MAX_MIGRANTS);
+    for (int i = 0; i < MAX_MIGRANTS; i++) immigrants[i].checkpoints = NULL;
+    migrants_seen = calloc(island_count, sizeof(unsigned int));
+    if (!migrants_seen) { perror("calloc"); exit(1); }
+
+    // an island scores its paths itself and keeps its own team of bests:
+    // its exploration bits are its own too, not the shared ones
+    void *bits = calloc(1, explore_bytes());
+    if (!bits) { perror("calloc"); exit(1); }
+    explore_attach(bits);
+
+    Chromosome *population = evolve_population();
+
+    // the top distinct paths: elites fill a converged population with copies
+    int *ranking = malloc(sizeof(int) * POPULATION_SIZE);
+    if (!ranking) { perror("malloc"); exit(1); }
+    rank_population(population, ranking, POPULATION_SIZE);
+
+    IslandResult *r = island_result(id);
+    const Chromosome *kept[TEAM_SIZE];
+    int top = 0;
+    for (int i = 0; i < POPULATION_SIZE && top < TEAM_SIZE; i++) {
+        const Chromosome *c = &population[ranking[i]];
+        int copy = 0;
+        for (int j = 0; j < top && !copy; j++) copy = same_path(kept[j], c);
+        if (copy) continue;
+        kept[top] = c;
+        r->fitness[top] = c->fitness;
+        r->length[top] = c->length;
+        r->start[top] = c->start;
+        memcpy(r->genes + top * path_words, c->genes, sizeof(uint64_t) * GENE_WORDS(c->length));
+        top++;
+    }
+    r->count = top;
+    free(ranking);
+    r->genes_simulated = genes_simulated;
+    r->genes_resumed = genes_resumed;
+    r->cache_hits = fitness_cache_hits;
+    r->cache_misses = fitness_cache_misses;
+    r->loop_allocations = ga_loop_allocations;
+    r->migrants_in = migrants_in;
+
+    fflush(stdout);   // _exit skips stdio: keep island 0's migration report
+    queue_push(shared->results, id);
+    _exit(0);
+}
 
-    sem_release.sem_num = SEM_START(id);
-    semop(semid, &sem_release, 1);
+// copy an island's i-th best out of its result
+static void island_path(const IslandResult *r, int i, Chromosome *c)
+{
+    c->fitness = r->fitness[i];
+    c->length = r->length[i];
+    c->start = r->start[i];
+    memcpy(c->genes, r->genes + i * path_words, sizeof(uint64_t) * GENE_WORDS(r->length[i]));
+}
+
+Chromosome* collect_islands(void)
+{
+    Chromosome *bests = alloc_population(island_count);
+    ga_loop_allocations = 0;
+
+    for (int done = 0; done < island_count; done++) {
+        int id = queue_pop_wait(shared->results);
+        IslandResult *r = island_result(id);
 
-    sem_acquire.sem_num = SEM_DONE(id);
-    semop(semid, &sem_acquire, 1);
+        island_path(r, 0, &bests[id]);
+        child_pool[id].last_used = time(NULL);
 
-    double f = shared->fitness[id];
+        genes_simulated += r->genes_simulated;
+        genes_resumed += r->genes_resumed;
+        fitness_cache_hits += r->cache_hits;
+        fitness_cache_misses += r->cache_misses;
+        ga_loop_allocations += r->loop_allocations;
 
-    // store best per robot
-    if (!best_initialized[id] || f > best_per_robot[id].fitness) {
-        best_per_robot[id].moves = malloc(sizeof(Move) * length);
-        for (int i = 0; i < length; i++)
-            best_per_robot[id].moves[i] = moves[i];
+        printf("Island %d | Best fitness = %.2f | migrants taken = %ld\n",
+               id, r->fitness[0], r->migrants_in);
+    }
 
-        best_per_robot[id].length = length;
-        best_per_robot[id].fitness = f;
-        best_per_robot[id].start = start;
-        best_initialized[id] = 1;
+    // every island has exited: reap them, so later scoring runs in-process
+    for (int id = 0; id < pool_capacity; id++) {
+        if (child_pool[id].robot_id < 0) continue;
+        waitpid(child_pool[id].pid, NULL, 0);
+        child_pool[id].pid = 0;
+        child_pool[id].robot_id = -1;
     }
+    child_count = 0;
+
+    // deal the team out round-robin over (island, rank): the islands' bests
+    // first, then their seconds, and so on. Migration makes islands converge,
+    // so a path (and start) a member already holds is skipped; only when the
+    // islands hold too few distinct paths does a member get a duplicate.
+    int k = 0, candidates = island_count * TEAM_SIZE;
+    for (int m = 0; m < TEAM_SIZE; m++) {
+        int dealt = 0;
+        for (; k < candidates && !dealt; k++) {
+            IslandResult *r = island_result(k % island_count);
+            int rank = k / island_count;
+            if (rank >= r->count) continue;
+            island_path(r, rank, &best_per_robot[m]);
+            dealt = 1;
+            for (int j = 0; j < m && dealt; j++)
+                if (same_path(&best_per_robot[j], &best_per_robot[m])) dealt = 0;
+        }
+        if (!dealt) {
+            IslandResult *r = island_result(m % island_count);
+            int rank = m / island_count;
+            if (rank >= r->count) rank = r->count - 1;
+            island_path(r, rank, &best_per_robot[m]);
+        }
+        best_initialized[m] = 1;
+        explore_publish(m, &best_per_robot[m]);
+    }
+    for (int id = TEAM_SIZE; id < island_count; id++)
+        note_best(id % TEAM_SIZE, &bests[id]);
 
-    release_child(child_pool[id].pid);
-    return f;
+    return bests;
 }
 
 Chromosome get_best_for_robot(int robot_id)
@@ -159,90 +743,274 @@ Chromosome get_best_for_robot(int robot_id)
     return best_per_robot[robot_id];
 }
 
-/* ---- pool management (unchanged logic) ---- */
+/* ---- pool management ---- */
 
+// fork a robot into the first free pool entry; -1 when the pool is full
 pid_t create_child()
 {
-    child_pool = realloc(child_pool, (child_count + 1) * sizeof(ChildProcess));
-    int id = child_count;
+    int id = 0;
+    while (id < pool_capacity && child_pool[id].robot_id >= 0) id++;
+    if (id == pool_capacity) return -1;
 
+    fflush(stdout);   // or the child inherits (and may re-print) buffered output
     pid_t pid = fork();
-    if (pid == 0) robot_worker_loop(id);
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        if (ISLAND_MODE) island_loop(id);
+        robot_worker_loop(id);
+    }
 
     child_pool[id].pid = pid;
-    child_pool[id].busy = 0;
     child_pool[id].robot_id = id;
     child_pool[id].last_used = time(NULL);
     child_count++;
+    robots_spawned++;
+    if (child_count > robots_peak) robots_peak = child_count;
 
     return pid;
 }
 
-void init_robot_pool(int num)
-{
-    shmid = shmget(IPC_PRIVATE, sizeof(SharedState), IPC_CREAT | 0666);
-    shared = shmat(shmid, NULL, 0);
-    memset(shared, 0, sizeof(SharedState));
+#define ALIGN64(n) (((n) + 63) & ~(size_t)63)
 
-    semid = semget(IPC_PRIVATE, 2 * MAX_ROBOTS, IPC_CREAT | 0660);
-    unsigned short vals[2 * MAX_ROBOTS] = {0};
-    union semun arg; arg.array = vals;
-    semctl(semid, 0, SETALL, arg);
+/* ---- population arena: a first-fit allocator the parent runs over shared->arena ---- */
 
-    for (int i = 0; i < num; i++) create_child();
-}
+// A block is its size in words (this word included) followed by the genomes.
+// Free blocks are listed by address: their second word is the next one's
+// offset, ARENA_END ends the list.
+#define ARENA_END ((uint64_t)-1)
+static uint64_t arena_free = ARENA_END;
 
-void shutdown_robot_pool(void)
+uint64_t *population_arena_alloc(size_t words)
 {
-    for (int i = 0; i < child_count; i++) {
-        shared->cmd[i] = CMD_EXIT;
-        sem_release.sem_num = SEM_START(i);
-        semop(semid, &sem_release, 1);
+    // islands and robots are forks: only the parent may carve the arena
+    if (!shared || IS_CHILD || words == 0) return NULL;
+
+    uint64_t *a = shared->arena;
+    uint64_t need = words + 1;
+    for (uint64_t prev = ARENA_END, at = arena_free; at != ARENA_END; prev = at, at = a[at + 1]) {
+        if (a[at] < need) continue;
+
+        uint64_t next = a[at + 1];
+        if (a[at] - need >= 2) {   // the rest stays free
+            a[at + need] = a[at] - need;
+            a[at + need + 1] = next;
+            next = at + need;
+            a[at] = need;
+        }
+        if (prev == ARENA_END) arena_free = next;
+        else a[prev + 1] = next;
+        return a + at + 1;
     }
+    return NULL;
+}
 
-    for (int i = 0; i < child_count; i++)
-        waitpid(child_pool[i].pid, NULL, 0);
-
-    shmdt(shared);
-    shmctl(shmid, IPC_RMID, NULL);
-    semctl(semid, 0, IPC_RMID);
-    
-    // Free best paths stored for each robot
-    for (int i = 0; i < MAX_ROBOTS; i++) {
-        if (best_initialized[i]) {
-            free(best_per_robot[i].moves);
-            best_per_robot[i].moves = NULL;
-            best_initialized[i] = 0;
-        }
+int population_arena_free(uint64_t *genes)
+{
+    if (!in_arena(genes)) return 0;
+
+    uint64_t *a = shared->arena;
+    uint64_t at = genes - 1 - a;
+    uint64_t prev = ARENA_END, next = arena_free;
+    while (next != ARENA_END && next < at) {
+        prev = next;
+        next = a[next + 1];
     }
 
-    free(child_pool);
+    // link it in, merging with the free neighbours on either side
+    a[at + 1] = next;
+    if (next != ARENA_END && at + a[at] == next) {
+        a[at] += a[next];
+        a[at + 1] = a[next + 1];
+    }
+    if (prev == ARENA_END) {
+        arena_free = at;
+    } else if (prev + a[prev] == at) {
+        a[prev] += a[at];
+        a[prev + 1] = a[at + 1];
+    } else {
+        a[prev + 1] = at;
+    }
+    return 1;
 }
 
-int get_free_child()
+// one segment: header, both rings, the job slots, the island boxes, the
+// exploration bitsets, the population arena and the staging areas. Genome
+// buffers are sized for the loaded map, so the segment grows with it.
+static void create_shared_state(int robots, size_t arena_words, int staged)
 {
-    int checked = child_count;
+    int slots = robots * SLOTS_PER_ROBOT;
+    if (slots < MIN_JOB_SLOTS) slots = MIN_JOB_SLOTS;
+    // every slot plus one JOB_EXIT / JOB_RETIRED per robot fits in a ring
+    unsigned int ring = queue_capacity_for(slots + robots);
+
+    path_words = GENE_WORDS(MAX_PATH_LENGTH);
+    box_bytes = ALIGN64(sizeof(MigrationBox) + sizeof(uint64_t) * MAX_MIGRANTS * path_words);
+    result_bytes = ALIGN64(sizeof(IslandResult) + sizeof(uint64_t) * TEAM_SIZE * path_words);
+
+    size_t at_jobs = ALIGN64(sizeof(SharedState));
+    size_t at_results = at_jobs + ALIGN64(queue_bytes(ring));
+    size_t at_retire = at_results + ALIGN64(queue_bytes(ring));
+    size_t at_slots = at_retire + ALIGN64(sizeof(unsigned int) * robots);
+    size_t at_migration = at_slots + ALIGN64(sizeof(JobSlot) * slots);
+    size_t at_island = at_migration + box_bytes * robots;
+    size_t at_explore = at_island + result_bytes * robots;
+    size_t at_arena = at_explore + ALIGN64(explore_bytes());
+    size_t at_staging = at_arena + ALIGN64(sizeof(uint64_t) * arena_words);
+    size_t total = at_staging + sizeof(uint64_t) * staged * path_words;
+
+    shmid = shmget(IPC_PRIVATE, total, IPC_CREAT | 0666);
+    if (shmid < 0) {
+        perror("shmget");
+        exit(1);
+    }
+    char *base = shmat(shmid, NULL, 0);
+    if (base == (char *)-1) {
+        perror("shmat");
+        exit(1);
+    }
+    memset(base, 0, total);
+
+    shared = (SharedState *)base;
+    shared->jobs = (JobQueue *)(base + at_jobs);
+    shared->results = (JobQueue *)(base + at_results);
+    shared->retire = (unsigned int *)(base + at_retire);
+    shared->slot_count = slots;
+    shared->slots = (JobSlot *)(base + at_slots);
+    shared->migration = base + at_migration;
+    shared->island = base + at_island;
+    shared->arena = (uint64_t *)(base + at_arena);
+    shared->arena_words = arena_words;
+    shared->staging = (uint64_t *)(base + at_staging);
+    queue_init(shared->jobs, ring);
+    queue_init(shared->results, ring);
+    explore_attach(base + at_explore);
+
+    // the whole arena starts as one free block
+    arena_free = ARENA_END;
+    if (arena_words >= 2) {
+        shared->arena[0] = arena_words;
+        shared->arena[1] = ARENA_END;
+        arena_free = 0;
+    }
+    nstaging = 0;
+    for (int i = staged - 1; i >= 0; i--) free_staging[nstaging++] = i;
+}
 
-    while (checked--) {
-        int i = rr_index;
-        rr_index = (rr_index + 1) % child_count;
+// num_robots is the most robots the pool may hold (0 = one per available
+// CPU). Island mode and the threads backend start them all at once; the
+// processes backend starts with none and grows with the evaluation backlog.
+void init_robot_pool(int num)
+{
+    if (num <= 0) num = available_cpus();
+    if (num > MAX_WORKERS) num = MAX_WORKERS;
+    pool_capacity = num;
+
+    // only forked robots fed through the rings need genomes in the segment:
+    // room for the GA's two populations (one per member in team mode), the
+    // team and the network arrivals, each path with its checkpoint cells
+    // and each block with its size word
+    size_t arena_words = 0;
+    int staged = 0;
+    if (EVAL_BACKEND == BACKEND_PROCESSES && !ISLAND_MODE) {
+        size_t words = GENE_WORDS(MAX_PATH_LENGTH) + CELL_WORDS(MAX_PATH_LENGTH);
+        size_t paths = 2 * (size_t)POPULATION_SIZE * (TEAM_MODE ? TEAM_SIZE : 1) + 2 * TEAM_SIZE + MAX_MIGRANTS + 1;
+        arena_words = paths * words + 16;
+        staged = STAGED_PATHS;
+    }
+    create_shared_state(num, arena_words, staged);
 
-        if (!child_pool[i].busy) {
-            child_pool[i].busy = 1;
+    child_pool = calloc(num, sizeof(ChildProcess));
+    if (!child_pool) {
+        perror("calloc");
+        exit(1);
+    }
+    for (int i = 0; i < num; i++) child_pool[i].robot_id = -1;
+    child_count = 0;
+    robots_spawned = robots_retired = 0;
+    robots_peak = 0;
+
+    // best paths are copied into these buffers, never reallocated
+    for (int i = 0; i < TEAM_SIZE; i++) {
+        best_per_robot[i].genes = ga_malloc(sizeof(uint64_t) * GENE_WORDS(MAX_PATH_LENGTH));
+        best_per_robot[i].checkpoints = NULL;
+        best_per_robot[i].cells = NULL;
+        best_per_robot[i].checkpoint_count = 0;
+        best_per_robot[i].length = 0;
+        best_initialized[i] = 0;
+    }
+    jobs_posted = 0;
+
+    // islands are whole processes, so island mode always forks
+    if (EVAL_BACKEND == BACKEND_THREADS && !ISLAND_MODE) {
+        // one cache line each, so aligned like one
+        if (posix_memalign((void **)&thread_counters, 64, sizeof(ThreadCounters) * num) != 0) {
+            perror("posix_memalign");
+            exit(1);
+        }
+        memset(thread_counters, 0, sizeof(ThreadCounters) * num);
+        for (int i = 0; i < num; i++) {
+            child_pool[i].pid = 0;
+            child_pool[i].robot_id = i;
             child_pool[i].last_used = time(NULL);
-            return i;
         }
+        child_count = robots_peak = num;
+        using_threads = 1;
+        workpool_start(num, evaluate_chunk, simulate_release_thread);
+        return;
+    }
+
+    if (ISLAND_MODE) {
+        island_count = num;
+        for (int i = 0; i < num; i++) create_child();
+        return;
     }
 
-    // no free robot
-    return -1;
+    job_of = ga_malloc(sizeof(int) * shared->slot_count);
+    free_slots = ga_malloc(sizeof(int) * shared->slot_count);
+    staged_in = ga_malloc(sizeof(int) * shared->slot_count);
 }
 
+void shutdown_robot_pool(void)
+{
+    if (using_threads) {
+        workpool_stop();
+        using_threads = 0;
+        free(thread_counters);
+        thread_counters = NULL;
+    } else {
+        for (int i = 0; i < child_count; i++)
+            queue_push(shared->jobs, JOB_EXIT);
+
+        for (int i = 0; i < pool_capacity; i++)
+            if (child_pool[i].robot_id >= 0)
+                waitpid(child_pool[i].pid, NULL, 0);
+    }
+
+    explore_detach();
+    shmdt(shared);
+    shmctl(shmid, IPC_RMID, NULL);
+    shared = NULL;
+    arena_free = ARENA_END;
+    nstaging = 0;
+    
+    // Free best paths stored for each robot
+    for (int i = 0; i < TEAM_SIZE; i++) {
+        free(best_per_robot[i].genes);
+        best_per_robot[i].genes = NULL;
+        best_initialized[i] = 0;
+    }
 
+    free(job_of);
+    free(free_slots);
+    free(staged_in);
+    job_of = free_slots = staged_in = NULL;
 
-void release_child(pid_t pid)
-{
-    for (int i = 0; i < child_count; i++)
-        if (child_pool[i].pid == pid)
-            child_pool[i].busy = 0;
-}
\ No newline at end of file
+    free(child_pool);
+    child_pool = NULL;
+    child_count = 0;
+    pool_capacity = 0;
+    island_count = 0;
+}
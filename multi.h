@@ -18,10 +18,23 @@
 #include "graph.h"      // for size_x, size_y, size_z, grid
 #include <sys/wait.h>
 
-//if we need less then the unused are removed using aging
-//if we need more then all robot will do more than 1 task 
-//if we need exactly 8 then all are used
-#define MAX_ROBOTS 8
+// robots in the final rescue team (report, collisions, visualization)
+#define TEAM_SIZE 8
+
+// The pool holds at most NUM_ROBOTS robots (0/auto = one per available CPU).
+// With the processes backend it grows while jobs queue up and aging() retires
+// robots that sat idle for WORKER_IDLE_SECONDS, down to none.
+#define MAX_WORKERS 256
+
+// island mode: migrants per exchange are capped so the shared boxes stay small
+#define MAX_MIGRANTS 8
+
+// who scores the paths (config EVAL_BACKEND=processes|threads)
+#define BACKEND_PROCESSES 0   // forked robots fed through the shared-memory rings
+#define BACKEND_THREADS   1   // work-stealing pthreads reading genomes in place
+
+#define TOPOLOGY_RING   0   // island i takes migrants from island i-1
+#define TOPOLOGY_RANDOM 1   // from a random other island at every exchange
 
 
 
@@ -29,30 +42,57 @@ typedef struct
 {
     pid_t pid;        // PID of the child process
     time_t last_used; // last time the process was used
-    int busy;         // 0 = free, 1 = working
-    int robot_id;     // 0..MAX_ROBOTS-1: which slot in shared state
+    int robot_id;     // index in child_pool, -1 while the entry is free
 } ChildProcess;
 
 pid_t create_child();
-int get_free_child();
-void release_child(pid_t);
-void aging(int);
+void aging(int max_idle_seconds);
+int available_cpus(void);   // affinity mask, capped by the cgroup CPU quota
 
 // Initialize / shutdown the robot pool + shared memory
 void init_robot_pool(int num_robots);
 void shutdown_robot_pool(void);
 
-//  get best result per robot
+//  get best result per team member (0..TEAM_SIZE-1)
 Chromosome get_best_for_robot(int robot_id);
+void set_best_for_robot(int robot_id, const Chromosome *c);   // replaces it
 
 extern double W_SURVIVORS;
 extern double W_COVERAGE;
 extern double W_LENGTH;
 extern double W_RISK;
-extern int child_count;
+extern int child_count;     // robots alive right now
+extern int WORKER_IDLE_SECONDS;
+extern long robots_spawned, robots_retired;
+extern int robots_peak;
 extern int IS_CHILD;
 extern ChildProcess *child_pool;
-double robot_evaluate_fitness(Move *moves, int length, Point start);
+extern long genes_simulated;
+extern long genes_resumed;
+// Processes backend: genome storage in the shared segment, so robots read
+// the population in place (alloc_population uses it while the pool is up).
+// NULL when there is no room or no such pool; the populations are only valid
+// until shutdown_robot_pool(). free returns 0 for genes not from the arena.
+uint64_t *population_arena_alloc(size_t words);
+int population_arena_free(uint64_t *genes);
+// member: team member it is scored for (novelty), or -1 for the next in turn
+double robot_evaluate_fitness(uint64_t *genes, int length, Point start, int member);
+// evaluate count chromosomes on all robots at once, fills in ->fitness
+void robot_evaluate_batch(Chromosome **batch, int count);
+
+extern int EVAL_BACKEND;
+
+// island mode (config: ISLAND_MODE, MIGRATION_INTERVAL, MIGRATION_COUNT, MIGRATION_TOPOLOGY)
+extern int ISLAND_MODE;
+extern int MIGRATION_INTERVAL;
+extern int MIGRATION_COUNT;
+extern int MIGRATION_TOPOLOGY;
+extern int island_id;
+// inside an island: publish the top migrants, take the neighbour's in place
+// of the worst individuals. Returns how many were taken.
+int island_migrate(Chromosome *population, const int *ranking);
+// parent: wait for every island, fill best_per_robot, return the island bests
+Chromosome* collect_islands(void);
 
 
 #endif
\ No newline at end of file
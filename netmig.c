@@ -0,0 +1,457 @@
+//netmig.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "netmig.h"
+#include "multi.h"
+
+#define NET_LATENCY_SAMPLES 4096
+
+typedef struct {
+    char addr[128];
+    int fd;                 // -1 while not connected
+    int connecting;         // non-blocking connect still in progress
+    unsigned char* out;
+    int out_len;
+} Peer;
+
+typedef struct {
+    int fd;
+    unsigned char* in;
+    int in_len;
+} Inbound;
+
+static int active = 0;
+static int listen_fd = -1;
+static Peer peers[NET_MAX_PEERS];
+static int peer_count = 0;
+static Inbound inbound[NET_MAX_INBOUND];
+static uint32_t fingerprint = 0;
+static Chromosome* arrivals = NULL;   // MAX_MIGRANTS decoded frames, re-scored locally
+static int arrival_count = 0;
+static Chromosome* incoming = NULL;   // frame being decoded (arrivals[MAX_MIGRANTS])
+
+static NetMigrationStats stats;
+// per connection: a whole frame of the longest path must fit inbound, and a
+// whole exchange (MAX_MIGRANTS of them) outbound
+static int in_bytes = NET_BUFFER_BYTES, out_bytes = NET_BUFFER_BYTES;
+static double start_ms = 0;
+static double latency_us[NET_LATENCY_SAMPLES];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------- little-endian codec ----------
+
+static void put_u16(unsigned char* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(unsigned char* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = v >> (8 * i); }
+static void put_u64(unsigned char* p, uint64_t v) { for (int i = 0; i < 8; i++) p[i] = v >> (8 * i); }
+static uint16_t get_u16(const unsigned char* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t get_u32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+static uint64_t get_u64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+// FNV-1a over the map size and cells: peers on a different map are ignored
+uint32_t map_fingerprint(void) {
+    uint32_t h = 2166136261u;
+    int dims[3] = {size_x, size_y, size_z};
+    for (int i = 0; i < 3; i++) { h ^= (uint32_t)dims[i]; h *= 16777619u; }
+    for (int i = 0; i < grid_cells; i++) { h ^= map_cell(i); h *= 16777619u; }
+    return h;
+}
+
+int net_encode_frame(unsigned char* out, const Chromosome* c, uint32_t map_id) {
+    int words = GENE_WORDS(c->length);
+    uint64_t fitness_bits;
+    memcpy(&fitness_bits, &c->fitness, sizeof(fitness_bits));
+
+    put_u32(out, NET_FRAME_MAGIC);
+    put_u32(out + 4, map_id);
+    put_u32(out + 8, (uint32_t)c->length);
+    put_u16(out + 12, (uint16_t)c->start.x);
+    put_u16(out + 14, (uint16_t)c->start.y);
+    put_u16(out + 16, (uint16_t)c->start.z);
+    put_u16(out + 18, 0);
+    put_u64(out + 20, fitness_bits);
+    put_u64(out + 28, now_ns());
+    for (int w = 0; w < words; w++)
+        put_u64(out + NET_FRAME_HEADER + 8 * w, c->genes[w]);
+
+    return NET_FRAME_HEADER + 8 * words;
+}
+
+// Bytes used (>0), 0 when the frame is not complete yet, -1 when the stream is
+// corrupt. A complete frame for another map or with an impossible start comes
+// back with c->length = -1.
+int net_decode_frame(const unsigned char* in, int avail, Chromosome* c,
+                     uint32_t map_id, uint64_t* sent_ns) {
+    if (avail < NET_FRAME_HEADER) return 0;
+    if (get_u32(in) != NET_FRAME_MAGIC) return -1;
+
+    uint32_t length = get_u32(in + 8);
+    if (length > (uint32_t)MAX_PATH_LENGTH) return -1;
+    int size = NET_FRAME_HEADER + 8 * GENE_WORDS((int)length);
+    if (avail < size) return 0;
+
+    Point start = { (int16_t)get_u16(in + 12), (int16_t)get_u16(in + 14), (int16_t)get_u16(in + 16) };
+    if (get_u32(in + 4) != map_id || !is_free_cell(start.x, start.y, start.z)) {
+        c->length = -1;
+        return size;
+    }
+
+    uint64_t fitness_bits = get_u64(in + 20);
+    memcpy(&c->fitness, &fitness_bits, sizeof(c->fitness));
+    *sent_ns = get_u64(in + 28);
+    c->length = (int)length;
+    c->start = start;
+    c->checkpoint_count = 0;
+
+    int words = GENE_WORDS(c->length);
+    for (int w = 0; w < words; w++)
+        c->genes[w] = get_u64(in + NET_FRAME_HEADER + 8 * w);
+    // keep the tail bits zero, as everywhere else
+    int tail = c->length % GENES_PER_WORD;
+    if (tail) c->genes[words - 1] &= ((uint64_t)1 << (GENE_BITS * tail)) - 1;
+
+    return size;
+}
+
+// ---------- sockets ----------
+
+// "unix:/path" or "host:port"; fills addr, returns its length or 0
+static socklen_t parse_address(const char* text, struct sockaddr_storage* addr) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (strncmp(text, "unix:", 5) == 0) {
+        struct sockaddr_un* un = (struct sockaddr_un*)addr;
+        un->sun_family = AF_UNIX;
+        strncpy(un->sun_path, text + 5, sizeof(un->sun_path) - 1);
+        return sizeof(*un);
+    }
+
+    char host[128];
+    const char* colon = strrchr(text, ':');
+    if (!colon || colon == text || (size_t)(colon - text) >= sizeof(host)) return 0;
+    memcpy(host, text, colon - text);
+    host[colon - text] = '\0';
+
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, colon + 1, &hints, &res) != 0 || !res) return 0;
+
+    socklen_t len = res->ai_addrlen;
+    memcpy(addr, res->ai_addr, len);
+    freeaddrinfo(res);
+    return len;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void peer_close(Peer* p) {
+    if (p->fd >= 0) close(p->fd);
+    p->fd = -1;
+    p->connecting = 0;
+    p->out_len = 0;
+}
+
+// (re)connect without waiting: the socket is usable once poll says writable
+static void peer_connect(Peer* p) {
+    struct sockaddr_storage addr;
+    socklen_t len = parse_address(p->addr, &addr);
+    if (!len) return;
+
+    int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    set_nonblocking(fd);
+    if (addr.ss_family == AF_INET) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (connect(fd, (struct sockaddr*)&addr, len) == 0) {
+        p->fd = fd;
+    } else if (errno == EINPROGRESS) {
+        p->fd = fd;
+        p->connecting = 1;
+    } else {
+        close(fd);
+    }
+}
+
+static void peer_poll_connect(Peer* p) {
+    struct pollfd pfd = { p->fd, POLLOUT, 0 };
+    if (poll(&pfd, 1, 0) <= 0) return;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(p->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) peer_close(p);
+    else p->connecting = 0;
+}
+
+static void peer_flush(Peer* p) {
+    int sent_total = 0;
+    while (sent_total < p->out_len) {
+        ssize_t n = send(p->fd, p->out + sent_total, p->out_len - sent_total,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) { sent_total += n; continue; }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        peer_close(p);   // peer went away: reconnect at the next exchange
+        return;
+    }
+    memmove(p->out, p->out + sent_total, p->out_len - sent_total);
+    p->out_len -= sent_total;
+    stats.bytes_sent += sent_total;
+}
+
+static void accept_peers(void) {
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) return;
+        set_nonblocking(fd);
+
+        int slot = -1;
+        for (int i = 0; i < NET_MAX_INBOUND && slot < 0; i++)
+            if (inbound[i].fd < 0) slot = i;
+        if (slot < 0) { close(fd); continue; }
+
+        inbound[slot].fd = fd;
+        inbound[slot].in_len = 0;
+    }
+}
+
+// keep the best MAX_MIGRANTS arrivals (by the sender's fitness) until the exchange
+static void keep_arrival(const Chromosome* c) {
+    int at = arrival_count;
+    if (arrival_count == MAX_MIGRANTS) {
+        at = 0;
+        for (int i = 1; i < MAX_MIGRANTS; i++)
+            if (arrivals[i].fitness < arrivals[at].fitness) at = i;
+        if (arrivals[at].fitness >= c->fitness) return;
+    } else {
+        arrival_count++;
+    }
+    copy_chromosome(&arrivals[at], c);
+}
+
+static void receive_from(Inbound* in, Chromosome* scratch) {
+    while (1) {
+        ssize_t n = recv(in->fd, in->in + in->in_len, in_bytes - in->in_len, MSG_DONTWAIT);
+        if (n > 0) {
+            in->in_len += n;
+            stats.bytes_received += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        } else {
+            n = -1;   // closed by the peer
+        }
+
+        int used = 0, bad = 0;
+        while (1) {
+            uint64_t sent = 0;
+            int size = net_decode_frame(in->in + used, in->in_len - used, scratch, fingerprint, &sent);
+            if (size == 0) break;
+            if (size < 0) { bad = 1; break; }
+            used += size;
+
+            if (scratch->length < 0) { stats.frames_rejected++; continue; }
+            stats.frames_received++;
+
+            double us = ((double)now_ns() - (double)sent) / 1000.0;
+            if (stats.latency_samples < NET_LATENCY_SAMPLES)
+                latency_us[stats.latency_samples++] = us;
+            keep_arrival(scratch);
+        }
+        memmove(in->in, in->in + used, in->in_len - used);
+        in->in_len -= used;
+
+        if (bad || n < 0) {
+            close(in->fd);
+            in->fd = -1;
+            in->in_len = 0;
+            return;
+        }
+    }
+}
+
+void net_migration_start(void) {
+    // one socket owner per GA instance: the parent, or island 0
+    if (!MIGRATION_LISTEN[0] || (IS_CHILD && island_id != 0)) return;
+
+    memset(&stats, 0, sizeof(stats));
+    fingerprint = map_fingerprint();
+
+    int longest = NET_FRAME_HEADER + 8 * GENE_WORDS(MAX_PATH_LENGTH);
+    in_bytes = longest > NET_BUFFER_BYTES ? longest : NET_BUFFER_BYTES;
+    out_bytes = MAX_MIGRANTS * longest > NET_BUFFER_BYTES ? MAX_MIGRANTS * longest : NET_BUFFER_BYTES;
+
+    struct sockaddr_storage addr;
+    socklen_t len = parse_address(MIGRATION_LISTEN, &addr);
+    if (!len) {
+        fprintf(stderr, "Warning: bad MIGRATION_LISTEN '%s', migration over sockets disabled\n",
+                MIGRATION_LISTEN);
+        return;
+    }
+    if (addr.ss_family == AF_UNIX) unlink(((struct sockaddr_un*)&addr)->sun_path);
+
+    listen_fd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (listen_fd < 0) { perror("socket"); exit(1); }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, (struct sockaddr*)&addr, len) < 0 || listen(listen_fd, NET_MAX_INBOUND) < 0) {
+        perror("bind/listen");
+        exit(1);
+    }
+    set_nonblocking(listen_fd);
+
+    for (int i = 0; i < NET_MAX_INBOUND; i++) {
+        inbound[i].fd = -1;
+        inbound[i].in = ga_malloc(in_bytes);
+        inbound[i].in_len = 0;
+    }
+
+    // peers: comma separated, connected lazily so start-up order does not matter
+    char list[sizeof(MIGRATION_PEERS)];
+    strncpy(list, MIGRATION_PEERS, sizeof(list) - 1);
+    list[sizeof(list) - 1] = '\0';
+    peer_count = 0;
+    for (char* tok = strtok(list, ", "); tok && peer_count < NET_MAX_PEERS; tok = strtok(NULL, ", ")) {
+        Peer* p = &peers[peer_count++];
+        strncpy(p->addr, tok, sizeof(p->addr) - 1);
+        p->addr[sizeof(p->addr) - 1] = '\0';
+        p->fd = -1;
+        p->connecting = 0;
+        p->out = ga_malloc(out_bytes);
+        p->out_len = 0;
+        peer_connect(p);
+    }
+
+    arrivals = alloc_population(MAX_MIGRANTS + 1);
+    for (int i = 0; i <= MAX_MIGRANTS; i++) arrivals[i].checkpoints = NULL;
+    incoming = &arrivals[MAX_MIGRANTS];
+    arrival_count = 0;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    start_ms = ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+    active = 1;
+}
+
+int net_migrate(Chromosome* population, const int* ranking) {
+    if (!active) return 0;
+
+    int count = MIGRATION_COUNT;
+    if (count > MAX_MIGRANTS) count = MAX_MIGRANTS;
+    if (count > POPULATION_SIZE) count = POPULATION_SIZE;
+
+    accept_peers();
+
+    // queue our elites for every peer, dropping what does not fit
+    for (int i = 0; i < peer_count; i++) {
+        Peer* p = &peers[i];
+        if (p->fd < 0) peer_connect(p);
+        if (p->fd >= 0 && p->connecting) peer_poll_connect(p);
+
+        for (int k = 0; k < count; k++) {
+            const Chromosome* c = &population[ranking[k]];
+            int size = NET_FRAME_HEADER + 8 * GENE_WORDS(c->length);
+            if (p->fd < 0 || p->out_len + size > out_bytes) {
+                stats.frames_dropped++;
+                continue;
+            }
+            p->out_len += net_encode_frame(p->out + p->out_len, c, fingerprint);
+            stats.frames_sent++;
+        }
+        if (p->fd >= 0 && !p->connecting) peer_flush(p);
+    }
+
+    for (int i = 0; i < NET_MAX_INBOUND; i++)
+        if (inbound[i].fd >= 0) receive_from(&inbound[i], incoming);
+
+    if (arrival_count == 0) return 0;
+
+    // the sender's fitness is only a hint: weights may differ between hosts
+    evaluate_population(arrivals, arrival_count);
+    int taken = take_migrants(population, arrivals, arrival_count);
+    arrival_count = 0;
+
+    stats.migrants_taken += taken;
+    return taken;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+NetMigrationStats net_migration_stats(void) {
+    return stats;
+}
+
+void net_migration_stop(void) {
+    if (!active) return;
+
+    // last best-effort flush, then hang up
+    for (int i = 0; i < peer_count; i++) {
+        if (peers[i].fd >= 0 && !peers[i].connecting) peer_flush(&peers[i]);
+        peer_close(&peers[i]);
+        free(peers[i].out);
+    }
+    for (int i = 0; i < NET_MAX_INBOUND; i++) {
+        if (inbound[i].fd >= 0) close(inbound[i].fd);
+        free(inbound[i].in);
+    }
+    close(listen_fd);
+    listen_fd = -1;
+    free_population(arrivals);
+    arrivals = NULL;
+    active = 0;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stats.elapsed_ms = ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6 - start_ms;
+
+    if (stats.latency_samples > 0) {
+        double sum = 0;
+        qsort(latency_us, stats.latency_samples, sizeof(double), compare_double);
+        for (int i = 0; i < stats.latency_samples; i++) sum += latency_us[i];
+        stats.latency_avg_us = sum / stats.latency_samples;
+        stats.latency_p50_us = latency_us[stats.latency_samples / 2];
+        stats.latency_p99_us = latency_us[stats.latency_samples * 99 / 100];
+        stats.latency_max_us = latency_us[stats.latency_samples - 1];
+    }
+
+    double secs = stats.elapsed_ms / 1000.0;
+    printf("[migration] %s | sent %ld frames (%.1f KiB, %ld dropped) | received %ld frames (%.1f KiB, %ld rejected) | %ld migrants taken\n",
+           MIGRATION_LISTEN, stats.frames_sent, stats.bytes_sent / 1024.0, stats.frames_dropped,
+           stats.frames_received, stats.bytes_received / 1024.0, stats.frames_rejected,
+           stats.migrants_taken);
+    printf("[migration] throughput %.0f frames/s out, %.0f frames/s in, %.1f KiB/s | "
+           "latency avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           secs > 0 ? stats.frames_sent / secs : 0.0, secs > 0 ? stats.frames_received / secs : 0.0,
+           secs > 0 ? (stats.bytes_sent + stats.bytes_received) / 1024.0 / secs : 0.0,
+           stats.latency_avg_us, stats.latency_p50_us, stats.latency_p99_us, stats.latency_max_us);
+}
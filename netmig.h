@@ -0,0 +1,52 @@
+//netmig.h
+// Migration between GA instances on different machines (or several rescue
+// processes on one box): elite chromosomes travel as small binary frames over
+// TCP or Unix-domain sockets. Sends never block; a slow peer just has frames
+// dropped once its outbound buffer is full.
+#ifndef NETMIG_H
+#define NETMIG_H
+
+#include "genetic.h"
+
+#define NET_MAX_PEERS    16
+#define NET_MAX_INBOUND  32
+#define NET_BUFFER_BYTES 65536   // per connection, each direction; more if MAX_PATH_LENGTH needs it
+
+// config: "host:port" or "unix:/path"; empty listen address = disabled
+extern char MIGRATION_LISTEN[256];
+extern char MIGRATION_PEERS[1024];   // comma separated addresses
+
+// Frame, all fields little-endian:
+//   u32 magic, u32 map fingerprint, u32 length, i16 x, i16 y, i16 z, u16 0,
+//   u64 fitness (IEEE-754 bits), u64 send time (ns, CLOCK_REALTIME),
+//   GENE_WORDS(length) x u64 packed moves
+#define NET_FRAME_MAGIC  0x474d4752u   // "RGMG"
+#define NET_FRAME_HEADER 36
+
+typedef struct {
+    long frames_sent, frames_dropped;
+    long frames_received, frames_rejected;
+    long bytes_sent, bytes_received;
+    long migrants_taken;
+    double elapsed_ms;
+    int latency_samples;
+    double latency_avg_us, latency_p50_us, latency_p99_us, latency_max_us;
+} NetMigrationStats;
+
+// Called around the GA loop by the process that owns the sockets (the parent,
+// or island 0 in island mode); both are no-ops when MIGRATION_LISTEN is empty.
+void net_migration_start(void);
+void net_migration_stop(void);
+// Ship the top MIGRATION_COUNT to every peer, take whatever arrived in place
+// of the worst individuals. Returns how many migrants were taken.
+int net_migrate(Chromosome* population, const int* ranking);
+
+NetMigrationStats net_migration_stats(void);
+
+// frame codec, exposed for the benchmark
+int net_encode_frame(unsigned char* out, const Chromosome* c, uint32_t fingerprint);
+int net_decode_frame(const unsigned char* in, int avail, Chromosome* c,
+                     uint32_t fingerprint, uint64_t* sent_ns);   // bytes used, 0 short, -1 bad
+uint32_t map_fingerprint(void);
+
+#endif
@@ -0,0 +1,153 @@
+//queue.c
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "queue.h"
+
+// the queue may sit in memory shared between processes, so no FUTEX_PRIVATE_FLAG
+static void futex_wait(unsigned int* addr, unsigned int expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(unsigned int* addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+unsigned int queue_capacity_for(unsigned int values) {
+    unsigned int capacity = QUEUE_MIN_CAPACITY;
+    while (capacity < values) capacity <<= 1;
+    return capacity;
+}
+
+size_t queue_bytes(unsigned int capacity) {
+    return sizeof(JobQueue) + sizeof(QueueCell) * capacity;
+}
+
+void queue_init(JobQueue* q, unsigned int capacity) {
+    q->head = 0;
+    q->tail = 0;
+    q->futex_word = 0;
+    q->waiters = 0;
+    q->mask = capacity - 1;
+    for (unsigned int i = 0; i < capacity; i++) {
+        q->cells[i].seq = i;
+        q->cells[i].value = 0;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+int queue_try_push(JobQueue* q, int value) {
+    unsigned int pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        QueueCell* cell = &q->cells[pos & q->mask];
+        unsigned int seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int dif = (int)(seq - pos);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->value = value;
+                __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+                break;
+            }
+        } else if (dif < 0) {
+            return 0;   // full
+        } else {
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    // wake a sleeper only if there is one: no syscall on the streaming path
+    __atomic_add_fetch(&q->futex_word, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->waiters, __ATOMIC_SEQ_CST) > 0)
+        futex_wake(&q->futex_word, 1);
+    return 1;
+}
+
+int queue_try_pop(JobQueue* q, int* value) {
+    unsigned int pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+    while (1) {
+        QueueCell* cell = &q->cells[pos & q->mask];
+        unsigned int seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int dif = (int)(seq - (pos + 1));
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *value = cell->value;
+                __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;   // empty
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void queue_push(JobQueue* q, int value) {
+    while (!queue_try_push(q, value))
+        sched_yield();
+}
+
+// spinning only pays off when the producer runs on another CPU meanwhile
+static int spin_limit = -1;
+
+static int stopped(const unsigned int* stop) {
+    return stop && __atomic_load_n(stop, __ATOMIC_SEQ_CST);
+}
+
+int queue_pop_wait_unless(JobQueue* q, int* value, const unsigned int* stop) {
+    if (spin_limit < 0)
+        spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? QUEUE_SPIN : 0;
+
+    for (int spin = 0; spin < spin_limit; spin++) {
+        if (queue_try_pop(q, value)) return 1;
+        if (stopped(stop)) return 0;
+        cpu_relax();
+    }
+
+    while (1) {
+        // announce ourselves before the last check so a concurrent push wakes us
+        __atomic_add_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+        unsigned int seen = __atomic_load_n(&q->futex_word, __ATOMIC_SEQ_CST);
+
+        if (queue_try_pop(q, value)) {
+            __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+            return 1;
+        }
+        // checked after reading futex_word: queue_wake_all bumps it after
+        // setting *stop, so the futex_wait below cannot miss that
+        if (stopped(stop)) {
+            __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+            return 0;
+        }
+
+        futex_wait(&q->futex_word, seen);
+        __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+
+        if (queue_try_pop(q, value)) return 1;
+    }
+}
+
+int queue_pop_wait(JobQueue* q) {
+    int value;
+    queue_pop_wait_unless(q, &value, NULL);
+    return value;
+}
+
+void queue_wake_all(JobQueue* q) {
+    __atomic_add_fetch(&q->futex_word, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&q->futex_word, INT_MAX);
+}
@@ -0,0 +1,39 @@
+//queue.h
+// Bounded multi-producer/multi-consumer ring of ints that can live in shared
+// memory. Push/pop are lock-free; a consumer only sleeps (futex) when empty.
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stddef.h>
+
+#define QUEUE_MIN_CAPACITY 256   // queue_capacity_for never goes below this
+#define QUEUE_SPIN         200   // polls before a consumer goes to sleep
+
+typedef struct {
+    unsigned int seq;   // ring lap stamp (Vyukov): tells producers/consumers whose turn it is
+    int value;
+} QueueCell;
+
+typedef struct {
+    unsigned int head __attribute__((aligned(64)));       // next position to pop
+    unsigned int tail __attribute__((aligned(64)));       // next position to push
+    unsigned int futex_word __attribute__((aligned(64))); // bumped on every push
+    unsigned int waiters;                                 // consumers asleep on futex_word
+    unsigned int mask;                                    // capacity - 1
+    QueueCell cells[];                                    // capacity of them
+} JobQueue;
+
+// capacity must be a power of two; queue_capacity_for rounds up to one
+unsigned int queue_capacity_for(unsigned int values);
+size_t queue_bytes(unsigned int capacity);
+void queue_init(JobQueue* q, unsigned int capacity);
+int  queue_try_push(JobQueue* q, int value);   // 0 when full
+int  queue_try_pop(JobQueue* q, int* value);   // 0 when empty
+void queue_push(JobQueue* q, int value);       // spins while full
+int  queue_pop_wait(JobQueue* q);              // sleeps while empty
+// as queue_pop_wait, but gives up (returns 0) once *stop is set; whoever sets
+// it calls queue_wake_all so sleepers see it
+int  queue_pop_wait_unless(JobQueue* q, int* value, const unsigned int* stop);
+void queue_wake_all(JobQueue* q);
+
+#endif
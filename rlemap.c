@@ -0,0 +1,117 @@
+//rlemap.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rlemap.h"
+
+static int rows = 0;
+static int* row_first = NULL;        // runs of row r: row_first[r] .. row_first[r+1]-1
+static uint16_t* run_end = NULL;     // column one past the run
+static uint8_t* run_value = NULL;
+static long run_count = 0;
+
+// the last run a thread found, as walks mostly stay in it
+static __thread int cursor_row = -1;
+static __thread int cursor_run = 0;
+static __thread int cursor_from = 0;
+
+int rle_build(void) {
+    if (stride_y > RLE_MAX_ROW) return 0;
+    rle_release();
+
+    rows = grid_cells / stride_y;
+    row_first = malloc(sizeof(int) * (rows + 1));
+    if (!row_first) { perror("malloc"); exit(1); }
+
+    // count first, then fill: the runs are one exact-size array
+    long n = 0;
+    for (int r = 0; r < rows; r++) {
+        const uint8_t* row = grid + (size_t)r * stride_y;
+        n++;
+        for (int x = 1; x < stride_y; x++) n += row[x] != row[x - 1];
+    }
+    run_end = malloc(sizeof(uint16_t) * n);
+    run_value = malloc(n);
+    if (!run_end || !run_value) { perror("malloc"); exit(1); }
+
+    n = 0;
+    for (int r = 0; r < rows; r++) {
+        const uint8_t* row = grid + (size_t)r * stride_y;
+        row_first[r] = n;
+        for (int x = 1; x <= stride_y; x++)
+            if (x == stride_y || row[x] != row[x - 1]) {
+                run_end[n] = x;
+                run_value[n] = row[x - 1];
+                n++;
+            }
+    }
+    row_first[rows] = n;
+    run_count = n;
+    cursor_row = -1;
+    return 1;
+}
+
+void rle_release(void) {
+    free(row_first);
+    free(run_end);
+    free(run_value);
+    row_first = NULL;
+    run_end = NULL;
+    run_value = NULL;
+    rows = 0;
+    run_count = 0;
+    cursor_row = -1;
+}
+
+size_t rle_bytes(void) {
+    return sizeof(int) * (rows + 1) + (sizeof(uint16_t) + 1) * run_count;
+}
+
+long rle_run_count(void) {
+    return run_count;
+}
+
+// index of the run holding column col of row r
+static inline int find_run(int r, int col) {
+    int lo = row_first[r], hi = row_first[r + 1] - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (run_end[mid] > col) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+uint8_t rle_cell(int idx) {
+    int r = idx / stride_y;
+    int col = idx - r * stride_y;
+    if (r == cursor_row && col >= cursor_from && col < run_end[cursor_run])
+        return run_value[cursor_run];
+
+    int k = find_run(r, col);
+    cursor_row = r;
+    cursor_run = k;
+    cursor_from = k > row_first[r] ? run_end[k - 1] : 0;
+    return run_value[k];
+}
+
+int rle_ray_x(int idx, int dir) {
+    int r = idx / stride_y;
+    int col = idx - r * stride_y;
+    int k = find_run(r, col);
+    int steps = 0;
+
+    if (dir > 0) {
+        steps = run_end[k] - col - 1;   // rest of idx's own run
+        if (run_value[k] == 1) return 0;
+        for (k++; k < row_first[r + 1] && run_value[k] != 1; k++)
+            steps = run_end[k] - col - 1;
+    } else {
+        int from = k > row_first[r] ? run_end[k - 1] : 0;
+        steps = col - from;
+        if (run_value[k] == 1) return 0;
+        for (k--; k >= row_first[r] && run_value[k] != 1; k--)
+            steps = col - (k > row_first[r] ? run_end[k - 1] : 0);
+    }
+    return steps;
+}
@@ -0,0 +1,26 @@
+//rlemap.h
+// Run-length encoded map (MAP_BACKEND=rle): every row of the padded grid is
+// a list of runs (end column, value), so open air and solid rubble cost a
+// few bytes per row instead of one per cell. Built from the dense grid at
+// load time, after which the grid is freed and map_cell() reads the runs.
+#ifndef RLEMAP_H
+#define RLEMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+
+#define RLE_MAX_ROW 65535   // run ends are 16-bit
+
+// encodes the loaded grid; returns 0 (and encodes nothing) if rows are too wide
+int rle_build(void);
+void rle_release(void);
+size_t rle_bytes(void);     // memory held by the encoding
+long rle_run_count(void);
+
+uint8_t rle_cell(int idx);  // map_cell() when grid is NULL
+// free cells from idx (exclusive) along +x (dir 1) or -x (dir -1) before
+// the first obstacle, a whole run at a time
+int rle_ray_x(int idx, int dir);
+
+#endif
@@ -0,0 +1,57 @@
+//rng.h
+// xoshiro256** streams. Every process or thread that breeds owns one Rng,
+// seeded from the master SEED plus its own stream number, so runs repeat
+// exactly for a given seed no matter how many robots score the paths.
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+// stream 0 is the parent's GA; island i breeds on stream i + 1
+extern __thread Rng ga_rng;
+extern unsigned long SEED;   // config SEED, 0 = pick one from the clock
+
+static inline uint64_t rng_splitmix(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// splitmix64 spreads (seed, stream) over the whole state, so neighbouring
+// seeds or streams do not start out correlated
+static inline void rng_seed(Rng* r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ rng_splitmix(&stream);
+    for (int i = 0; i < 4; i++) r->s[i] = rng_splitmix(&x);
+}
+
+static inline uint64_t rng_next(Rng* r) {
+    uint64_t* s = r->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// uniform in [0, n) (multiply-shift, bias below 2^-32 for the n used here)
+static inline int rng_below(Rng* r, int n) {
+    return (int)(((rng_next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+// uniform in [0, 1)
+static inline double rng_unit(Rng* r) {
+    return (rng_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif
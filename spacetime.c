@@ -0,0 +1,75 @@
+//spacetime.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spacetime.h"
+
+static inline unsigned int st_hash(uint64_t key, unsigned int mask) {
+    return (unsigned int)((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+static void st_alloc(SpaceTimeTable* t, unsigned int capacity) {
+    t->entries = calloc(capacity, sizeof(SpaceTimeEntry));
+    if (!t->entries) { perror("calloc"); exit(1); }
+    t->mask = capacity - 1;
+    t->count = 0;
+}
+
+void st_init(SpaceTimeTable* t, int expected) {
+    unsigned int capacity = 64;
+    while (capacity < 2u * (unsigned int)expected) capacity <<= 1;   // load <= 1/2
+    st_alloc(t, capacity);
+}
+
+void st_clear(SpaceTimeTable* t) {
+    memset(t->entries, 0, sizeof(SpaceTimeEntry) * (t->mask + 1));
+    t->count = 0;
+}
+
+void st_free(SpaceTimeTable* t) {
+    free(t->entries);
+    t->entries = NULL;
+    t->mask = 0;
+    t->count = 0;
+}
+
+static void st_grow(SpaceTimeTable* t) {
+    SpaceTimeEntry* old = t->entries;
+    unsigned int old_capacity = t->mask + 1;
+
+    st_alloc(t, old_capacity * 2);
+    for (unsigned int i = 0; i < old_capacity; i++) {
+        if (!old[i].key) continue;
+        unsigned int h = st_hash(old[i].key, t->mask);
+        while (t->entries[h].key) h = (h + 1) & t->mask;
+        t->entries[h] = old[i];
+        t->count++;
+    }
+    free(old);
+}
+
+SpaceTimeEntry* st_insert(SpaceTimeTable* t, uint64_t key) {
+    if (2u * (unsigned int)(t->count + 1) > t->mask + 1) st_grow(t);
+
+    uint64_t stored = key + 1;
+    unsigned int h = st_hash(stored, t->mask);
+    while (t->entries[h].key && t->entries[h].key != stored) h = (h + 1) & t->mask;
+
+    SpaceTimeEntry* e = &t->entries[h];
+    if (!e->key) {
+        e->key = stored;
+        e->a = e->b = 0;
+        t->count++;
+    }
+    return e;
+}
+
+SpaceTimeEntry* st_find(const SpaceTimeTable* t, uint64_t key) {
+    uint64_t stored = key + 1;
+    unsigned int h = st_hash(stored, t->mask);
+    while (t->entries[h].key) {
+        if (t->entries[h].key == stored) return &t->entries[h];
+        h = (h + 1) & t->mask;
+    }
+    return NULL;
+}
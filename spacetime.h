@@ -0,0 +1,39 @@
+//spacetime.h
+// Open-addressing hash table keyed by (cell, time) or (cell, time, move):
+// space-time occupancy for collision checks, costs O(path length) instead of
+// O(map cells) per time step. Each entry carries two ints for the caller.
+#ifndef SPACETIME_H
+#define SPACETIME_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t key;   // 0 = empty slot (keys are stored + 1)
+    int a, b;
+} SpaceTimeEntry;
+
+typedef struct {
+    SpaceTimeEntry* entries;
+    unsigned int mask;   // capacity - 1
+    int count;
+} SpaceTimeTable;
+
+static inline uint64_t st_key(int cell, int t) {
+    return ((uint64_t)(uint32_t)t << 32) | (uint32_t)cell;
+}
+
+// a move out of cell at time t (move is a Move, 0..5)
+static inline uint64_t st_edge_key(int cell, int t, int move) {
+    return ((uint64_t)(uint32_t)t << 35) | ((uint64_t)(uint32_t)cell << 3) | (uint64_t)move;
+}
+
+void st_init(SpaceTimeTable* t, int expected);   // room for `expected` keys before growing
+void st_clear(SpaceTimeTable* t);
+void st_free(SpaceTimeTable* t);
+
+// the entry for key, inserted with a = b = 0 if it was missing
+SpaceTimeEntry* st_insert(SpaceTimeTable* t, uint64_t key);
+// the entry for key, or NULL
+SpaceTimeEntry* st_find(const SpaceTimeTable* t, uint64_t key);
+
+#endif
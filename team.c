@@ -0,0 +1,182 @@
+//team.c
+#include <stdio.h>
+#include <stdlib.h>
+#include "team.h"
+#include "multi.h"
+#include "fitcache.h"
+#include "explore.h"
+
+void reservation_init(ReservationTable* r, int expected) {
+    st_init(&r->occupied, expected);
+    st_init(&r->cells, expected);
+    st_init(&r->moves, expected);
+    r->stamp = 0;
+}
+
+void reservation_clear(ReservationTable* r) {
+    st_clear(&r->occupied);
+    st_clear(&r->cells);
+    st_clear(&r->moves);
+}
+
+void reservation_free(ReservationTable* r) {
+    st_free(&r->occupied);
+    st_free(&r->cells);
+    st_free(&r->moves);
+}
+
+// Walks c the way detect_collisions() does (stopping before an obstacle)
+// and adds delta to every count it touches; a cell counts once per path.
+static void reserve(ReservationTable* r, const Chromosome* c, int delta) {
+    int idx = point_to_index(c->start);
+    int stamp = ++r->stamp;
+
+    for (int t = 0; ; t++) {
+        if (t < c->length) st_insert(&r->occupied, st_key(idx, t))->a += delta;
+
+        SpaceTimeEntry* e = st_insert(&r->cells, st_key(idx, 0));
+        if (e->b != stamp) {
+            e->b = stamp;
+            e->a += delta;
+        }
+
+        if (t == c->length) break;
+        int m = get_move(c, t);
+        int next = idx + move_delta[m];
+        if (map_cell(next) == 1) break;
+
+        st_insert(&r->moves, st_edge_key(idx, t, m))->a += delta;
+        idx = next;
+    }
+}
+
+void reservation_add(ReservationTable* r, const Chromosome* c) {
+    reserve(r, c, 1);
+}
+
+void reservation_remove(ReservationTable* r, const Chromosome* c) {
+    reserve(r, c, -1);
+}
+
+CollisionReport reservation_conflicts(ReservationTable* r, const Chromosome* c) {
+    CollisionReport report = {0, 0, 0, 0};
+    int idx = point_to_index(c->start);
+    int stamp = ++r->stamp;
+
+    for (int t = 0; ; t++) {
+        SpaceTimeEntry* e;
+        if (t < c->length && (e = st_find(&r->occupied, st_key(idx, t))))
+            report.total_temporal_collisions += e->a;
+
+        // joining a cell some robot already uses adds one shared cell
+        e = st_find(&r->cells, st_key(idx, 0));
+        if (e && e->a > 0 && e->b != stamp) {
+            e->b = stamp;
+            report.total_spatial_collisions++;
+            report.conflicted_cells_count++;
+        }
+
+        if (t == c->length) break;
+        int m = get_move(c, t);
+        int next = idx + move_delta[m];
+        if (map_cell(next) == 1) break;
+
+        if ((e = st_find(&r->moves, st_edge_key(next, t, m ^ 1))))
+            report.total_swap_conflicts += e->a;
+        idx = next;
+    }
+    return report;
+}
+
+// Scores member m's subpopulation against the other members' bests and makes
+// its top path the member's new best. pop already holds the robots' fitness.
+static void settle_member(ReservationTable* r, Chromosome* team, int m, int seated,
+                          Chromosome* pop, int* ranking, int top_k) {
+    if (seated) reservation_remove(r, &team[m]);
+
+    for (int i = 0; i < POPULATION_SIZE; i++)
+        pop[i].fitness -= collision_penalty(reservation_conflicts(r, &pop[i]));
+
+    rank_population(pop, ranking, top_k);
+    copy_chromosome(&team[m], &pop[ranking[0]]);
+    reservation_add(r, &team[m]);
+    explore_publish(m, &team[m]);
+}
+
+static int team_collisions(const Chromosome* team) {
+    CollisionReport c = detect_collisions(team, TEAM_SIZE);
+    return c.total_temporal_collisions + c.total_spatial_collisions + c.total_swap_conflicts;
+}
+
+Chromosome* evolve_team(void) {
+    int n = POPULATION_SIZE;
+    int total = TEAM_SIZE * n;
+
+    // all subpopulations share one slab, so a generation is scored in one batch
+    Chromosome* population = alloc_population(total);
+    Chromosome* new_population = alloc_population(total);
+    int* ranking = ga_malloc(sizeof(int) * total);
+    Chromosome* team = alloc_population(TEAM_SIZE);
+
+    int elite_count = (int)(n * ELITE_PERCENT);
+    if (elite_count < 1) elite_count = 1;
+    int top_k = tournament_size();
+    if (elite_count > top_k) top_k = elite_count;
+    if (top_k > n) top_k = n;
+
+    for (int i = 0; i < total; i++) create_seeded_individual(&population[i]);
+    evaluate_population(population, total);
+
+    ReservationTable reserved;
+    reservation_init(&reserved, TEAM_SIZE * 64);
+    for (int m = 0; m < TEAM_SIZE; m++)
+        settle_member(&reserved, team, m, 0, population + m * n, ranking + m * n, top_k);
+
+    long allocs_before_loop = ga_heap_allocations;
+
+    for (int gen = 0; gen < MAX_GENERATIONS; gen++) {
+
+        if (gen == 0 || gen == MAX_GENERATIONS - 1 || (gen + 1) % 50 == 0) {
+            printf("Generation %d | Team fitness = %.2f | collisions = %d\n",
+                   gen + 1, evaluate_team_fitness(team, TEAM_SIZE), team_collisions(team));
+        }
+
+        for (int m = 0; m < TEAM_SIZE; m++)
+            breed_generation(population + m * n, ranking + m * n, new_population + m * n, elite_count);
+
+        // elites too: their penalty was charged against teammates that may
+        // have changed since, so every path gets its plain fitness back
+        // (mostly from the cache) and is charged again
+        evaluate_population(new_population, total);
+
+        Chromosome* temp = population;
+        population = new_population;
+        new_population = temp;
+
+        for (int m = 0; m < TEAM_SIZE; m++)
+            settle_member(&reserved, team, m, 1, population + m * n, ranking + m * n, top_k);
+
+        // replaced bests leave zero counts behind; start over before they
+        // make up most of the table
+        int live = 0;
+        for (int m = 0; m < TEAM_SIZE; m++) live += team[m].length + 1;
+        if (reserved.occupied.count > 4 * live) {
+            reservation_clear(&reserved);
+            for (int m = 0; m < TEAM_SIZE; m++) reservation_add(&reserved, &team[m]);
+        }
+    }
+
+    ga_loop_allocations = ga_heap_allocations - allocs_before_loop;
+
+    // report each member with its own fitness, without the team penalty
+    for (int m = 0; m < TEAM_SIZE; m++) {
+        team[m].fitness = evaluate_member_fitness(&team[m], m);
+        set_best_for_robot(m, &team[m]);
+    }
+
+    reservation_free(&reserved);
+    free_population(population);
+    free_population(new_population);
+    free(ranking);
+    return team;
+}
@@ -0,0 +1,33 @@
+//team.h
+// Team co-evolution (TEAM_MODE=1): one subpopulation per team member, bred
+// in lock-step. A member's candidates are scored by the robots as usual and
+// then charged the collisions they would cause with the current bests of
+// the other members, held in a space-time reservation table. The penalty is
+// exactly what evaluate_team_fitness() would lose, so the team is made
+// collision-free during evolution rather than checked afterwards.
+#ifndef TEAM_H
+#define TEAM_H
+
+#include "genetic.h"
+#include "spacetime.h"
+
+typedef struct {
+    SpaceTimeTable occupied;   // (cell, t) -> robots there before move t
+    SpaceTimeTable cells;      // cell -> robots that ever enter it
+    SpaceTimeTable moves;      // (cell, t, move) -> robots making that move
+    int stamp;                 // marks the cells already counted for one path
+} ReservationTable;
+
+void reservation_init(ReservationTable* r, int expected);   // room for `expected` path steps
+void reservation_clear(ReservationTable* r);
+void reservation_free(ReservationTable* r);
+void reservation_add(ReservationTable* r, const Chromosome* c);
+void reservation_remove(ReservationTable* r, const Chromosome* c);   // c must have been added
+// the collisions c would add to a team made of the reserved paths
+CollisionReport reservation_conflicts(ReservationTable* r, const Chromosome* c);
+
+// evolves the team; returns TEAM_SIZE paths (one free()), each with its own
+// fitness, and also hands them to the robot pool's team (get_best_for_robot)
+Chromosome* evolve_team(void);
+
+#endif
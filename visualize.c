@@ -35,7 +35,7 @@ static float colors[8][3] = {
 static Point pos_after_k_moves(const Chromosome *c, int k) {
     Point p = c->start;
     if (k > c->length) k = c->length;
-    for (int i = 0; i < k; i++) p = apply_move(p, c->moves[i]);
+    for (int i = 0; i < k; i++) p = apply_move(p, get_move(c, i));
     return p;
 }
 
@@ -97,7 +97,7 @@ static void draw_map_cells() {
 
         for (int y = 0; y < size_y; y++) {
             for (int x = 0; x < size_x; x++) {
-                int cell = grid[z][y][x];
+                int cell = MAP_CELL(x, y, z);
                 if (cell == 0) continue;
 
                 float wx, wy, wz;
@@ -132,7 +132,7 @@ static void draw_robot_path_lines() {
         glVertex3f(wx, wy + 0.12f, wz);
 
         for (int i = 0; i < team[r].length; i++) {
-            p = apply_move(p, team[r].moves[i]);
+            p = apply_move(p, get_move(&team[r], i));
             cell_to_world(p.x, p.y, p.z, &wx, &wy, &wz);
             glVertex3f(wx, wy + 0.12f, wz);
         }
@@ -205,6 +205,7 @@ static void display() {
 }
 
 static void timer(int v) {
+    (void)v;
     if (!paused) {
         for (int r = 0; r < nrobots; r++) {
             if (step_index[r] >= team[r].length) continue;
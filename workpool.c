@@ -0,0 +1,197 @@
+//workpool.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "workpool.h"
+#include "genetic.h"   // ga_malloc
+
+typedef struct {
+    long top __attribute__((aligned(64)));      // thieves take from here
+    long bottom __attribute__((aligned(64)));   // the owner pops from here
+    int* tasks;
+    pthread_t thread;
+    int id;
+} Worker;
+
+static Worker* workers = NULL;
+static int worker_count = 0;
+static int capacity = 0;   // tasks per deque
+
+static WorkFn work_fn = NULL;
+static void (*exit_fn)(void) = NULL;
+static void* work_arg = NULL;
+
+// batches are handed out under the lock; the tasks themselves are lock-free
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cv = PTHREAD_COND_INITIALIZER;
+static long epoch = 0;
+static int busy = 0;
+static int stopping = 0;
+
+long workpool_steals = 0;
+
+// owner side: -1 when the deque is empty
+static int pop_own(Worker* w) {
+    long b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+    if (t > b) {
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    int task = w->tasks[b];
+    if (t == b) {
+        // last task: race the thieves for it
+        if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            task = -1;
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+// thief side: -1 when empty, -2 when another thread won the race
+static int steal_from(Worker* w) {
+    long t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return -1;
+
+    int task = w->tasks[t];
+    if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return -2;
+    return task;
+}
+
+// Tasks are only added between batches, so once every deque is empty the
+// batch has nothing left to hand out.
+static void run_batch(Worker* self) {
+    long stolen = 0;
+
+    while (1) {
+        int task = pop_own(self);
+        if (task >= 0) {
+            work_fn(self->id, task, work_arg);
+            continue;
+        }
+
+        int contended = 0;
+        for (int k = 1; k < worker_count && task < 0; k++) {
+            task = steal_from(&workers[(self->id + k) % worker_count]);
+            if (task == -2) contended = 1;
+        }
+        if (task >= 0) {
+            stolen++;
+            work_fn(self->id, task, work_arg);
+            continue;
+        }
+        if (!contended) break;
+    }
+
+    if (stolen) __atomic_add_fetch(&workpool_steals, stolen, __ATOMIC_RELAXED);
+}
+
+static void* worker_main(void* arg) {
+    Worker* self = arg;
+    long seen = 0;
+
+    pthread_mutex_lock(&lock);
+    while (1) {
+        while (epoch == seen && !stopping) pthread_cond_wait(&start_cv, &lock);
+        if (stopping) break;
+        seen = epoch;
+        pthread_mutex_unlock(&lock);
+
+        run_batch(self);
+
+        pthread_mutex_lock(&lock);
+        if (--busy == 0) pthread_cond_signal(&done_cv);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (exit_fn) exit_fn();
+    return NULL;
+}
+
+void workpool_start(int threads, WorkFn fn, void (*on_exit)(void)) {
+    if (threads < 1) threads = 1;
+    if (threads > WORKPOOL_MAX_THREADS) threads = WORKPOOL_MAX_THREADS;
+
+    // Worker is cache-line aligned, which calloc does not promise
+    if (posix_memalign((void**)&workers, 64, sizeof(Worker) * threads) != 0) {
+        perror("posix_memalign");
+        exit(1);
+    }
+    memset(workers, 0, sizeof(Worker) * threads);
+    worker_count = threads;
+    capacity = 0;
+    work_fn = fn;
+    exit_fn = on_exit;
+    stopping = 0;
+    workpool_steals = 0;
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].id = i;
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+}
+
+void workpool_run(int tasks, void* arg) {
+    if (tasks <= 0) return;
+
+    pthread_mutex_lock(&lock);
+
+    // every thread is parked between batches, so the deques can be refilled
+    int per_worker = (tasks + worker_count - 1) / worker_count;
+    if (per_worker > capacity) {
+        for (int i = 0; i < worker_count; i++) {
+            free(workers[i].tasks);
+            workers[i].tasks = ga_malloc(sizeof(int) * per_worker);   // counted with the GA's own
+        }
+        capacity = per_worker;
+    }
+
+    // contiguous ranges keep neighbouring tasks on one thread
+    for (int i = 0; i < worker_count; i++) {
+        int first = (int)((long)tasks * i / worker_count);
+        int last = (int)((long)tasks * (i + 1) / worker_count);
+        for (int t = first; t < last; t++) workers[i].tasks[t - first] = t;
+        workers[i].top = 0;
+        workers[i].bottom = last - first;
+    }
+
+    work_arg = arg;
+    busy = worker_count;
+    epoch++;
+    pthread_cond_broadcast(&start_cv);
+    while (busy > 0) pthread_cond_wait(&done_cv, &lock);
+
+    pthread_mutex_unlock(&lock);
+}
+
+void workpool_stop(void) {
+    if (!workers) return;
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&start_cv);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].tasks);
+    }
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
+    capacity = 0;
+}
@@ -0,0 +1,19 @@
+//workpool.h
+// Work-stealing thread pool. A batch of numbered tasks is split evenly over
+// per-thread deques; each thread pops its own tasks from the bottom and, once
+// it runs dry, steals from the top of the others' (Chase-Lev).
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#define WORKPOOL_MAX_THREADS 256
+
+typedef void (*WorkFn)(int worker, int task, void* arg);
+
+// on_exit (may be NULL) runs in each thread before it ends
+void workpool_start(int threads, WorkFn fn, void (*on_exit)(void));
+void workpool_run(int tasks, void* arg);   // returns once every task has run
+void workpool_stop(void);
+
+extern long workpool_steals;   // tasks run by a thread that did not own them
+
+#endif